@@ -0,0 +1,261 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * every generation each child is a trial for the shapes that made it
+ * and the ops it drew; a child that sorts into the elite set is a win.
+ * every ADAPT_PERIOD generations the arms are re-weighted by their
+ * win rate, shrunk towards the mean so sparse arms aren't judged on
+ * a handful of trials, and never below ADAPT_FLOOR of the best arm.
+ * op weights scale the module/option weights from x86_init() and
+ * rebuild the pick table; shape weights thin gen_mutate()'s draw.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typ.h"
+#include "x86.h"
+#include "gen.h"
+#include "adapt.h"
+
+extern const struct x86 X86[X86_COUNT];
+
+#define MAX(a,b) ((a)>(b)?(a):(b))
+
+int Adapt = 1;
+u32 Adapt_Keep[MUT_COUNT] = {
+  0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF,
+  0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF
+};
+
+static const char *Shape_Name[MUT_COUNT] = {
+  "insert",
+  "delete",
+  "replace1",
+  "replace2",
+  "replace4",
+  "replaceN"
+};
+
+static u32    Base[X86_COUNT]; /* x86_init()'s weights, before learning */
+static double Op_Try[X86_COUNT],
+              Op_Win[X86_COUNT],
+              Mut_Try[MUT_COUNT],
+              Mut_Win[MUT_COUNT],
+              Op_Factor[X86_COUNT],
+              Mut_Factor[MUT_COUNT];
+static u32    Gens = 0;
+
+void adapt_init(void)
+{
+  u32 i;
+  memcpy(Base, X86_Weight, sizeof Base);
+  for (i = 0; i < X86_COUNT; i++)
+    Op_Factor[i] = 1.;
+  for (i = 0; i < MUT_COUNT; i++)
+    Mut_Factor[i] = 1.;
+}
+
+/**
+ * turn win/try counts into factors in [ADAPT_FLOOR, 1]; arms with
+ * on[i] == 0 are left alone. returns 0 if nothing has been tried.
+ */
+static int factors(const double *win, const double *try, const u32 *on,
+                   u32 n, double *f)
+{
+  double wins = 0,
+         tries = 0,
+         mean,
+         best = 0,
+         r;
+  u32 i;
+  for (i = 0; i < n; i++)
+    if (!on || on[i])
+      wins += win[i], tries += try[i];
+  if (0 == wins || 0 == tries)
+    return 0;
+  mean = wins / tries;
+  for (i = 0; i < n; i++) {
+    if (on && !on[i])
+      continue;
+    r = (win[i] + ADAPT_PRIOR) / (try[i] + ADAPT_PRIOR / mean);
+    f[i] = r;
+    if (r > best)
+      best = r;
+  }
+  for (i = 0; i < n; i++)
+    if (!on || on[i])
+      f[i] = ADAPT_FLOOR + (1. - ADAPT_FLOOR) * f[i] / best;
+  return 1;
+}
+
+static void update(void)
+{
+  u32 i;
+  if (factors(Op_Win, Op_Try, Base, X86_COUNT, Op_Factor)) {
+    for (i = 0; i < X86_COUNT; i++)
+      if (Base[i])
+        X86_Weight[i] = MAX(1, (u32)(Base[i] * Op_Factor[i] + 0.5));
+    x86_pick_build();
+  }
+  if (factors(Mut_Win, Mut_Try, NULL, MUT_COUNT, Mut_Factor))
+    for (i = 0; i < MUT_COUNT; i++)
+      Adapt_Keep[i] = (u32)(Mut_Factor[i] * 4294967295.);
+  for (i = 0; i < X86_COUNT; i++)
+    Op_Try[i] *= ADAPT_DECAY, Op_Win[i] *= ADAPT_DECAY;
+  for (i = 0; i < MUT_COUNT; i++)
+    Mut_Try[i] *= ADAPT_DECAY, Mut_Win[i] *= ADAPT_DECAY;
+}
+
+static void tally(const struct gen_mut *m, double *op, double *mut)
+{
+  u32 i;
+  for (i = 0; i < m->nop; i++)
+    op[m->op[i]] += 1.;
+  for (i = 0; i < MUT_COUNT; i++)
+    if (m->shape & (1 << i))
+      mut[i] += 1.;
+}
+
+/**
+ * called from pop_score() once p->scores[0..scored) is sorted and
+ * before the elites are moved up front. children are told apart from
+ * surviving elites by a non-empty mut record, which is cleared here
+ * so an elite is only ever credited in the generation it was born.
+ */
+void adapt_credit(struct pop *p, u32 scored, const genx_iface *iface)
+{
+  u32 keep = iface->opt.pop_keep < scored ? iface->opt.pop_keep : scored,
+      i;
+  for (i = 0; i < keep; i++) {
+    const struct gen_mut *m = &p->indiv[p->scores[i].id].geno.mut;
+    tally(m, Op_Win, Mut_Win);
+  }
+  for (i = 0; i < iface->opt.pop_size; i++) {
+    struct gen_mut *m = &p->indiv[i].geno.mut;
+    if (m->nop | m->shape) {
+      tally(m, Op_Try, Mut_Try);
+      m->nop = 0;
+      m->shape = 0;
+    }
+  }
+  if (0 == ++Gens % ADAPT_PERIOD)
+    update();
+}
+
+static int mnemonic_len(const char *descr)
+{
+  return (int)strcspn(descr, " ");
+}
+
+/**
+ * read counts from a previous run of the same module as a prior;
+ * ops are matched by index and mnemonic so a changed X86[] table
+ * just drops the lines that no longer fit
+ */
+int adapt_load(const char *path)
+{
+  char line[128],
+       name[32];
+  double win, try;
+  unsigned idx;
+  u32 i,
+      skipped = 0;
+  FILE *f = fopen(path, "r");
+  if (NULL == f) {
+    perror(path);
+    return 0;
+  }
+  while (fgets(line, sizeof line, f)) {
+    if (4 == sscanf(line, "op %u %31s %lf %lf", &idx, name, &win, &try)) {
+      if (idx < X86_COUNT && Base[idx]
+       && (int)strlen(name) == mnemonic_len(X86[idx].descr)
+       && 0 == strncmp(name, X86[idx].descr, strlen(name))) {
+        Op_Win[idx] = win;
+        Op_Try[idx] = try;
+      } else {
+        skipped++;
+      }
+    } else if (3 == sscanf(line, "mut %31s %lf %lf", name, &win, &try)) {
+      for (i = 0; i < MUT_COUNT; i++)
+        if (0 == strcmp(name, Shape_Name[i]))
+          break;
+      if (i < MUT_COUNT) {
+        Mut_Win[i] = win;
+        Mut_Try[i] = try;
+      } else {
+        skipped++;
+      }
+    }
+  }
+  fclose(f);
+  printf("adapt: loaded %s", path);
+  if (skipped)
+    printf(" (%" PRIu32 " stale lines skipped)", skipped);
+  putchar('\n');
+  update();
+  return 1;
+}
+
+int adapt_save(const char *path)
+{
+  u32 i;
+  FILE *f = fopen(path, "w");
+  if (NULL == f) {
+    perror(path);
+    return 0;
+  }
+  fprintf(f, "# genx adapt: op <index> <mnemonic> <wins> <trials>\n");
+  for (i = X86_FIRST; i < X86_COUNT; i++)
+    if (Base[i])
+      fprintf(f, "op %" PRIu32 " %.*s %.3f %.3f\n", i,
+        mnemonic_len(X86[i].descr), X86[i].descr, Op_Win[i], Op_Try[i]);
+  fprintf(f, "# mut <shape> <wins> <trials>\n");
+  for (i = 0; i < MUT_COUNT; i++)
+    fprintf(f, "mut %s %.3f %.3f\n", Shape_Name[i], Mut_Win[i], Mut_Try[i]);
+  return 0 == fclose(f);
+}
+
+static int factor_cmp(const void *va, const void *vb)
+{
+  const u8 *a = va,
+           *b = vb;
+  return (Op_Factor[*a] < Op_Factor[*b]) - (Op_Factor[*a] > Op_Factor[*b]);
+}
+
+/**
+ * shape factors, then the most and least favoured ops
+ */
+void adapt_report(FILE *f)
+{
+  u8 ord[X86_COUNT];
+  u32 i,
+      n = 0;
+  if (!Adapt)
+    return;
+  fprintf(f, "ADAPT mut");
+  for (i = 0; i < MUT_COUNT; i++)
+    fprintf(f, " %s %.2f", Shape_Name[i], Mut_Factor[i]);
+  fputc('\n', f);
+  for (i = X86_FIRST; i < X86_COUNT; i++)
+    if (Base[i])
+      ord[n++] = (u8)i;
+  qsort(ord, n, sizeof ord[0], factor_cmp);
+  fprintf(f, "ADAPT op ");
+  for (i = 0; i < n; i++) {
+    if (i == 8 && n > 16) {
+      fprintf(f, " ...");
+      i = n - 8;
+    }
+    fprintf(f, " %.*s %.2f", mnemonic_len(X86[ord[i]].descr),
+      X86[ord[i]].descr, Op_Factor[ord[i]]);
+  }
+  fputc('\n', f);
+}
+
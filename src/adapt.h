@@ -0,0 +1,55 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * learn during a run which ops and which mutation shapes produce
+ * children that make it into the elite set, and sample more of them
+ */
+
+#ifndef ADAPT_H
+#define ADAPT_H
+
+#include <stdio.h>
+#include "typ.h"
+#include "rnd.h"
+#include "gen.h"
+
+#define ADAPT_PERIOD 16   /* generations between weight updates     */
+#define ADAPT_FLOOR  0.1  /* worst arm keeps this share of the best */
+#define ADAPT_DECAY  0.9  /* applied to all counts at each update   */
+#define ADAPT_PRIOR  4.   /* pseudo-wins pulling arms to the mean   */
+
+extern int Adapt;                 /* learning enabled?               */
+extern u32 Adapt_Keep[MUT_COUNT]; /* rnd32() <= this: accept a shape */
+
+static inline enum mut_shape mut_shape(u32 olen, u32 rlen)
+{
+  if (rlen > olen)
+    return MUT_INSERT;
+  if (rlen < olen)
+    return MUT_DELETE;
+  if (0 == olen)
+    return MUT_COUNT;
+  if (olen <= 2)
+    return MUT_REPLACE1 + olen - 1;
+  return olen <= 4 ? MUT_REPLACE4 : MUT_REPLACEN;
+}
+
+static inline int adapt_keep(enum mut_shape s)
+{
+  return MUT_COUNT == s || rnd32() <= Adapt_Keep[s];
+}
+
+void adapt_init(void);
+void adapt_credit(struct pop *, u32 scored, const genx_iface *);
+int  adapt_load(const char *path);
+int  adapt_save(const char *path);
+void adapt_report(FILE *);
+
+#endif
+
@@ -0,0 +1,190 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * the canonical form, built from the Eff[] register effects:
+ *
+ *  - reg == r/m no-ops (EFF_NOP) are dropped
+ *  - each op gets a level one past the ops it must follow (Foata
+ *    normal form); ops are listed by level, and within a level by
+ *    their bytes with the renameable registers masked out
+ *  - registers that hold the same value in every test at entry (edx,
+ *    and ebx/ecx when the tests pass 0 there) are renamed in the
+ *    order that order first uses them
+ *
+ * two genotypes with the same form compute the same thing. jumps
+ * index ops by position and ops Eff[] doesn't know could touch
+ * anything; genotypes with either are hashed as compiled.
+ */
+
+#include <string.h>
+#include "typ.h"
+#include "x86.h"
+#include "eff.h"
+#include "canon.h"
+
+extern const struct x86 X86[X86_COUNT];
+
+#define CANON_MAX  DEFAULT_CHROMO_MAX
+#define CANON_NONE 4 /* esp; stands in for a masked register */
+
+static u32 Free = 1 << 2; /* registers every test zeroes */
+
+void canon_init(const genx_iface *iface)
+{
+  const struct genx_test *t = iface->test.i.data.list;
+  u32 in1 = 0,
+      in2 = 0,
+      i;
+  for (i = 0; i < iface->test.i.data.len; i++) {
+    in1 |= t[i].in[1];
+    in2 |= t[i].in[2];
+  }
+  t = iface->v2.screen.list;
+  for (i = 0; i < iface->v2.screen.len; i++) {
+    in1 |= t[i].in[1];
+    in2 |= t[i].in[2];
+  }
+  /* shim_i: in[1] in ebx, in[2] in ecx, edx zeroed */
+  Free = 1 << 2 | (in1 ? 0 : 1 << 3) | (in2 ? 0 : 1 << 1);
+  if (SCORE_HASH == iface->test.i.score) /* the word and what's left */
+    Free = 1 << 2;
+}
+
+static inline u64 canon_mix(u64 h, u64 w)
+{
+  h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+  return h ^ h >> 29;
+}
+
+/* the bytes of an op that matter in one word, registers mapped through map[] */
+static u64 canon_op(const struct op *o, const u8 map[8])
+{
+  const struct x86 *x = X86 + o->x86;
+  u64 w = o->x86;
+  if (x->modrmlen) {
+    u8 reg = o->modrm >> 3 & 7;
+    if ((Eff[o->x86].rd | Eff[o->x86].wr) & EFF_REG)
+      reg = map[reg];
+    w |= (u64)((o->modrm & 0xC0) | reg << 3 | map[o->modrm & 7]) << 8;
+  }
+  if (x->vex)
+    w |= (u64)map[o->data[0] & 7] << 16;
+  if (x->immlen) {
+    u32 imm;
+    memcpy(&imm, o->data, sizeof imm);
+    if (x->immlen < 4)
+      imm &= (1U << 8 * x->immlen) - 1;
+    w |= (u64)imm << 24;
+  }
+  return w;
+}
+
+/* compiled as-is */
+static u64 canon_raw(const genotype *g)
+{
+  static const u8 id[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+  u64 h = 0;
+  u32 i;
+  for (i = GEN_PREFIX_LEN; i < g->len - GEN_SUFFIX_LEN; i++)
+    h = canon_mix(h, canon_op(g->chromo + i, id));
+  return h;
+}
+
+u64 canon_hash(const genotype *g)
+{
+  const struct op *o[CANON_MAX];
+  u64 key[CANON_MAX], /* the op, renameable registers masked */
+      h = 0;
+  u32 lv[CANON_MAX],   /* dependency level: 1 + that of what it waits on */
+      ord[CANON_MAX],
+      at[CANON_MAX + 2], /* next slot in ord[], per level */
+      lo[CANON_MAX + 2], /* first slot                    */
+      lastw[9] = { 0 }, /* level of the last write, per eff_regs() bit */
+      lastr[9] = { 0 }, /* highest level reading it since              */
+      n = 0,
+      top = 0,
+      next = 0,
+      i, j;
+  u8 mask[8],
+     map[8];
+  for (i = 0; i < 8; i++) {
+    mask[i] = Free >> i & 1 ? CANON_NONE : (u8)i;
+    map[i] = Free >> i & 1 ? 0xFF : (u8)i;
+  }
+  for (i = GEN_PREFIX_LEN; i < g->len - GEN_SUFFIX_LEN; i++) {
+    const struct op *p = g->chromo + i;
+    const struct eff *e = Eff + p->x86;
+    u32 rd, wr, m, l = 0, r;
+    if (X86[p->x86].jcc || 0 == (e->rd | e->wr) || n == CANON_MAX)
+      return canon_raw(g);
+    if ((e->flag & EFF_NOP) && (p->modrm >> 3 & 7) == (p->modrm & 7))
+      continue;
+    rd = eff_regs(p, e->rd);
+    wr = eff_regs(p, e->wr);
+    if ((e->flag & EFF_SAME) && (p->modrm >> 3 & 7) == (p->modrm & 7))
+      rd = 0;
+    for (m = rd | wr; m; m &= m - 1) {
+      r = __builtin_ctz(m);
+      if (lastw[r] > l)
+        l = lastw[r];
+      if (wr >> r & 1 && lastr[r] > l)
+        l = lastr[r];
+    }
+    l++;
+    for (m = rd & ~wr; m; m &= m - 1) {
+      r = __builtin_ctz(m);
+      if (lastr[r] < l)
+        lastr[r] = l;
+    }
+    for (m = wr; m; m &= m - 1) {
+      r = __builtin_ctz(m);
+      lastw[r] = l;
+      lastr[r] = 0;
+    }
+    if (l > top)
+      top = l;
+    lv[n] = l;
+    key[n] = canon_op(p, mask);
+    o[n++] = p;
+  }
+  /* by level, then by masked op within a level */
+  memset(at, 0, (top + 2) * sizeof at[0]);
+  for (i = 0; i < n; i++)
+    at[lv[i] + 1]++;
+  for (i = 1; i <= top + 1; i++)
+    at[i] += at[i - 1];
+  memcpy(lo, at, (top + 2) * sizeof at[0]);
+  for (i = 0; i < n; i++) {
+    u32 k = at[lv[i]]++;
+    while (k > lo[lv[i]] && key[ord[k - 1]] > key[i]) {
+      ord[k] = ord[k - 1];
+      k--;
+    }
+    ord[k] = i;
+  }
+  /* rename by first use in that order */
+  for (i = 0; i < n; i++) {
+    const struct op *p = o[ord[i]];
+    const u8 r[3] = {
+      (u8)(((Eff[p->x86].rd | Eff[p->x86].wr) & EFF_REG) ? p->modrm >> 3 & 7 : CANON_NONE),
+      (u8)(X86[p->x86].modrmlen ? p->modrm & 7 : CANON_NONE),
+      (u8)(X86[p->x86].vex ? p->data[0] & 7 : CANON_NONE)
+    };
+    for (j = 0; j < 3; j++) {
+      if (0xFF != map[r[j]])
+        continue;
+      while (next < 8 && !(Free >> next & 1))
+        next++;
+      map[r[j]] = (u8)next++;
+    }
+    h = canon_mix(h, canon_op(p, map));
+  }
+  return h;
+}
+
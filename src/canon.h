@@ -0,0 +1,25 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * a hash of a genotype's behaviour rather than its bytes: no-ops
+ * dropped, independent ops in a fixed order, registers that start out
+ * equal renamed by first use. run.c keys its score cache on it.
+ */
+
+#ifndef CANON_H
+#define CANON_H
+
+#include "typ.h"
+#include "gen.h"
+
+void canon_init(const genx_iface *); /* again whenever the tests change */
+u64  canon_hash(const genotype *);   /* after gen_compile() */
+
+#endif
+
@@ -0,0 +1,569 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * CSV: one row per line, inputs then the output, numbers in any base
+ * strtoll() reads. an optional first line of names marks the column
+ * called "weight" as the row weight. blank lines and '#' comments are
+ * skipped.
+ *
+ * a set bigger than genx keeps is sampled in one pass: CSV by
+ * reservoir, GENXDAT1 by selection sampling over the mapped columns,
+ * which touches the pages in order and keeps the rows in file order.
+ * either way genx scores the sample as rows; the mapping is dropped
+ * once it has been taken.
+ */
+
+#define _FILE_OFFSET_BITS 64 /* fseeko() past 2GB under -m32 */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#ifdef linux
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+#include "typ.h"
+#include "gen.h"
+#include "data.h"
+
+#define DATA_LINE 1024
+#define DATA_BUF  4096 /* values buffered per column by data_csv2bin() */
+
+#define ALIGN(n) (((n) + DATA_ALIGN - 1) & ~(size_t)(DATA_ALIGN - 1))
+
+u32 Data_Rows = DATA_ROWS;
+
+static struct genx_test *Rows = NULL;
+static u32              *Row_Weight = NULL;
+
+struct csv {
+  FILE       *f;
+  const char *path;
+  u32         cols,  /* fields per line */
+              wcol,  /* the weight field, or cols */
+              line;
+};
+
+/* xorshift64*; the sample is fixed by genx's -s */
+static u64 data_rnd(u64 *s)
+{
+  *s ^= *s >> 12;
+  *s ^= *s << 25;
+  *s ^= *s >> 27;
+  return *s * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * split line into at most max numbers; with name, fields that aren't
+ * numbers are names, else they are an error
+ * @return fields, or -1
+ */
+static int csv_split(char *line, u32 *v, u32 max, char **name)
+{
+  char *p = line,
+       *end;
+  int n = 0;
+  for (;;) {
+    while (' ' == *p || '\t' == *p)
+      p++;
+    if ('\0' == *p || '\n' == *p || '\r' == *p || '#' == *p)
+      break;
+    if ((u32)n == max)
+      return -1;
+    if (name)
+      name[n] = NULL;
+    v[n] = (u32)strtoll(p, &end, 0);
+    if (end == p) {
+      if (!name)
+        return -1;
+      name[n] = p;
+      end = p + strcspn(p, ",\r\n");
+    }
+    n++;
+    p = end;
+    while (' ' == *p || '\t' == *p)
+      p++;
+    if (',' != *p)
+      break;
+    p++;
+  }
+  return n;
+}
+
+static int csv_open(struct csv *c, const char *path)
+{
+  char line[DATA_LINE],
+       *name[6];
+  u32 v[6];
+  int n = 0,
+      i;
+  off_t at = 0;
+  c->path = path;
+  c->line = 0;
+  c->f = fopen(path, "r");
+  if (NULL == c->f) {
+    perror(path);
+    return 0;
+  }
+  while (0 == n) {
+    at = ftello(c->f);
+    if (NULL == fgets(line, sizeof line, c->f)) {
+      fprintf(stderr, "%s: no rows\n", path);
+      fclose(c->f);
+      return 0;
+    }
+    c->line++;
+    n = csv_split(line, v, 6, name);
+  }
+  if (n < 2) {
+    fprintf(stderr, "%s:%u: need at least an input and an output\n", path, c->line);
+    fclose(c->f);
+    return 0;
+  }
+  c->cols = (u32)n;
+  c->wcol = (u32)n;
+  for (i = 0; i < n && NULL == name[i]; i++)
+    ;
+  if (i < n) { /* names */
+    for (i = 0; i < n; i++)
+      if (name[i] && 0 == strncasecmp(name[i], "weight", 6) && !isalnum((unsigned char)name[i][6]))
+        c->wcol = (u32)i;
+  } else {
+    fseeko(c->f, at, SEEK_SET);
+    c->line--;
+  }
+  if (c->cols - (c->wcol < c->cols) - 1 > 3) {
+    fprintf(stderr, "%s: more than 3 inputs\n", path);
+    fclose(c->f);
+    return 0;
+  }
+  return 1;
+}
+
+static u32 csv_inputs(const struct csv *c)
+{
+  return c->cols - (c->wcol < c->cols) - 1;
+}
+
+/**
+ * @return 1 for a row, 0 at the end, -1 on a bad line
+ */
+static int csv_next(struct csv *c, struct genx_test *t, u32 *w)
+{
+  char line[DATA_LINE];
+  u32 v[6],
+      i, k;
+  int n;
+  do {
+    if (NULL == fgets(line, sizeof line, c->f))
+      return 0;
+    c->line++;
+    n = csv_split(line, v, 6, NULL);
+  } while (0 == n);
+  if (n < 0) {
+    fprintf(stderr, "%s:%u: not a number\n", c->path, c->line);
+    return -1;
+  }
+  if ((u32)n != c->cols) {
+    fprintf(stderr, "%s:%u: %d fields, expected %u\n", c->path, c->line, n, c->cols);
+    return -1;
+  }
+  memset(t, 0, sizeof *t);
+  *w = 1;
+  for (i = k = 0; i < c->cols; i++) {
+    if (i == c->wcol)
+      *w = v[i];
+    else if (k < csv_inputs(c))
+      t->in[k++] = v[i];
+    else
+      t->out = v[i];
+  }
+  return 1;
+}
+
+/**
+ * map a GENXDAT1 file
+ */
+int data_open(struct data *d, const char *path)
+{
+  const struct data_hdr *h;
+  size_t col,
+         need;
+  u32 i;
+#ifdef linux
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+  memset(d, 0, sizeof *d);
+  if (-1 == fd || -1 == fstat(fd, &st)) {
+    perror(path);
+    if (-1 != fd)
+      close(fd);
+    return 0;
+  }
+  d->maplen = (size_t)st.st_size;
+  d->map = d->maplen < sizeof *h ? MAP_FAILED
+         : mmap(0, d->maplen, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (MAP_FAILED == d->map) {
+    fprintf(stderr, "%s: can't map\n", path);
+    d->map = NULL;
+    return 0;
+  }
+#else
+  FILE *f = fopen(path, "rb");
+  memset(d, 0, sizeof *d);
+  if (NULL == f) {
+    perror(path);
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  d->maplen = (size_t)ftell(f);
+  rewind(f);
+  d->map = malloc(d->maplen + 1);
+  assert(d->map);
+  d->maplen = fread(d->map, 1, d->maplen, f);
+  fclose(f);
+#endif
+  h = d->map;
+  if (d->maplen < sizeof *h || memcmp(h->magic, DATA_MAGIC, sizeof h->magic)
+   || h->cols < 1 || h->cols > 3) {
+    fprintf(stderr, "%s: not a " DATA_MAGIC " file\n", path);
+    data_close(d);
+    return 0;
+  }
+  /* the last column needn't be padded out */
+  col = ALIGN((size_t)h->rows * sizeof(u32));
+  need = ALIGN(sizeof *h) + col * (h->cols + !!(h->flags & DATA_WEIGHT))
+       + (size_t)h->rows * sizeof(u32);
+  if (d->maplen < need) {
+    fprintf(stderr, "%s: cut short\n", path);
+    data_close(d);
+    return 0;
+  }
+  d->rows = h->rows;
+  d->cols = h->cols;
+  for (i = 0; i < d->cols; i++)
+    d->in[i] = (const u32 *)((const u8 *)d->map + ALIGN(sizeof *h) + i * col);
+  d->out = (const u32 *)((const u8 *)d->map + ALIGN(sizeof *h) + i * col);
+  if (h->flags & DATA_WEIGHT)
+    d->weight = (const u32 *)((const u8 *)d->map + ALIGN(sizeof *h) + (i + 1) * col);
+  return 1;
+}
+
+void data_close(struct data *d)
+{
+  if (d->map) {
+#ifdef linux
+    munmap(d->map, d->maplen);
+#else
+    free(d->map);
+#endif
+  }
+  memset(d, 0, sizeof *d);
+}
+
+/* has path the GENXDAT1 magic? */
+static int data_is_bin(const char *path)
+{
+  char magic[8];
+  FILE *f = fopen(path, "rb");
+  int is = 0;
+  if (f) {
+    is = sizeof magic == fread(magic, 1, sizeof magic, f)
+      && 0 == memcmp(magic, DATA_MAGIC, sizeof magic);
+    fclose(f);
+  }
+  return is;
+}
+
+static void rows_alloc(u32 n, int weighted)
+{
+  free(Rows);
+  free(Row_Weight);
+  Rows = malloc((n ? n : 1) * sizeof *Rows);
+  assert(Rows);
+  Row_Weight = NULL;
+  if (weighted) {
+    Row_Weight = malloc((n ? n : 1) * sizeof *Row_Weight);
+    assert(Row_Weight);
+  }
+}
+
+/* the mapped set, every row or an even sample of max */
+static u32 data_take_bin(const struct data *d, u32 max, u64 *s)
+{
+  u32 n = d->rows < max ? d->rows : max,
+      k = 0,
+      i, c;
+  rows_alloc(n, NULL != d->weight);
+  for (i = 0; i < d->rows && k < n; i++) {
+    /* Knuth's algorithm S: take row i with chance need/left */
+    if ((data_rnd(s) >> 11) * (1. / 9007199254740992.) * (d->rows - i) >= n - k)
+      continue;
+    memset(Rows + k, 0, sizeof *Rows);
+    for (c = 0; c < d->cols; c++)
+      Rows[k].in[c] = d->in[c][i];
+    Rows[k].out = d->out[i];
+    if (Row_Weight)
+      Row_Weight[k] = d->weight[i];
+    k++;
+  }
+  return k;
+}
+
+/**
+ * reservoir; every row has the same chance of being among the max kept
+ * @return rows kept in *n and read in *seen, 0 on a bad line
+ */
+static int data_take_csv(struct csv *c, u32 max, u64 *s, u32 *n, u64 *seen)
+{
+  struct genx_test t;
+  u32 w,
+      cap = max < 4096 ? max : 4096;
+  int r;
+  Rows = realloc(Rows, cap * sizeof *Rows);
+  Row_Weight = realloc(Row_Weight, cap * sizeof *Row_Weight);
+  assert(Rows && Row_Weight);
+  *seen = 0;
+  *n = 0;
+  while (1 == (r = csv_next(c, &t, &w))) {
+    u64 j = *seen;
+    if (*n < max) {
+      if (*n == cap) {
+        cap = cap * 2 < max ? cap * 2 : max;
+        Rows = realloc(Rows, cap * sizeof *Rows);
+        Row_Weight = realloc(Row_Weight, cap * sizeof *Row_Weight);
+        assert(Rows && Row_Weight);
+      }
+      j = (*n)++;
+    } else {
+      j = data_rnd(s) % (*seen + 1);
+    }
+    if (j < max) {
+      Rows[j] = t;
+      Row_Weight[j] = w;
+    }
+    (*seen)++;
+  }
+  if (c->wcol == c->cols) {
+    free(Row_Weight);
+    Row_Weight = NULL;
+  }
+  return r >= 0;
+}
+
+/**
+ * replace iface's tests with (a sample of) the set in path
+ */
+int data_load(genx_iface *iface, const char *path, u32 max, u32 seed)
+{
+  u64 s = seed | (u64)0x9E3779B9 << 32,
+      total;
+  u32 n,
+      inputs;
+  int r;
+  if (0 == max)
+    max = DATA_ROWS;
+  if (data_is_bin(path)) {
+    struct data d;
+    if (!data_open(&d, path))
+      return 0;
+    n = data_take_bin(&d, max, &s);
+    total = d.rows;
+    inputs = d.cols;
+    data_close(&d);
+  } else {
+    struct csv c;
+    if (!csv_open(&c, path))
+      return 0;
+    r = data_take_csv(&c, max, &s, &n, &total);
+    inputs = csv_inputs(&c);
+    fclose(c.f);
+    if (!r)
+      return 0;
+  }
+  if (0 == n) {
+    fprintf(stderr, "%s: no rows\n", path);
+    return 0;
+  }
+  printf("data: %s: %llu rows, %" PRIu32 " input%s%s",
+    path, (unsigned long long)total, inputs, 1 == inputs ? "" : "s",
+    Row_Weight ? ", weighted" : "");
+  if (n < total)
+    printf(", kept %" PRIu32, n);
+  printf("\n");
+  if (iface->opt.param_cnt < inputs)
+    iface->opt.param_cnt = inputs;
+  iface->test.i.data.len = n;
+  iface->test.i.data.list = Rows;
+  iface->v2.weight = Row_Weight;
+  /* rows the module picked for its own table don't apply */
+  iface->v2.screen.len = 0;
+  return 1;
+}
+
+static u32 *Gen_Col[4] = { NULL }; /* in[0..2], out */
+static u32  Gen_Seed;
+
+/* rows [0, v2.rows) of the table from the v2 callbacks */
+static void data_fill(genx_iface *iface, struct genx_test *t, u32 seed)
+{
+  const struct genx_v2 *v = &iface->v2;
+  u32 *const in[3] = { Gen_Col[0], Gen_Col[1], Gen_Col[2] };
+  u32 i, k;
+  if (v->inputs) {
+    v->inputs(in, v->rows, seed);
+  } else {
+    u64 s = seed | (u64)0x9E3779B9 << 32;
+    for (k = 0; k < 3; k++) {
+      const u32 lo = k < v->domains ? v->domain[k].lo : 0,
+                hi = k < v->domains ? v->domain[k].hi : 0xFFFFFFFFU;
+      const u64 span = (u64)hi - lo + 1;
+      for (i = 0; i < v->rows; i++)
+        in[k][i] = k < iface->opt.param_cnt ? lo + (u32)(((data_rnd(&s) >> 32) * span) >> 32) : 0;
+    }
+  }
+  if (v->ref) {
+    v->ref((const u32 *const *)in, Gen_Col[3], v->rows);
+  } else {
+    for (i = 0; i < v->rows; i++) {
+      const u32 x[4] = { in[0][i], in[1][i], in[2][i], 0 };
+      Gen_Col[3][i] = iface->test.i.func(x);
+    }
+  }
+  for (i = 0; i < v->rows; i++) {
+    memset(t + i, 0, sizeof *t);
+    for (k = 0; k < 3; k++)
+      t[i].in[k] = in[k][i];
+    t[i].out = Gen_Col[3][i];
+  }
+}
+
+/**
+ * build a v2 module's table
+ */
+int data_gen(genx_iface *iface, u32 seed)
+{
+  const struct genx_v2 *v = &iface->v2;
+  u32 k;
+  if (!v->inputs && iface->opt.param_cnt > 3) {
+    fprintf(stderr, "data: more than 3 params to draw\n");
+    return 0;
+  }
+  if (!v->ref && !iface->test.i.func) {
+    fprintf(stderr, "data: v2 module has neither ref nor func\n");
+    return 0;
+  }
+  for (k = 0; k < 4; k++) {
+    free(Gen_Col[k]);
+    Gen_Col[k] = malloc(v->rows * sizeof *Gen_Col[k]);
+    assert(Gen_Col[k]);
+  }
+  rows_alloc(v->rows, 0);
+  Gen_Seed = seed;
+  data_fill(iface, Rows, seed);
+  iface->test.i.data.len = v->rows;
+  iface->test.i.data.list = Rows;
+  iface->v2.weight = NULL;
+  printf("data: %" PRIu32 " generated rows", v->rows);
+  if (v->refresh)
+    printf(", new ones every %" PRIu32 " generations", v->refresh);
+  printf("\n");
+  return 1;
+}
+
+/**
+ * every v2.refresh generations draw the generated rows again; rows
+ * appended after them (verify's counterexamples) stay
+ * @return non-zero if the table changed
+ */
+int data_refresh(genx_iface *iface, u32 gen)
+{
+  if (NULL == Gen_Col[3] || 0 == iface->v2.refresh || 0 == gen || gen % iface->v2.refresh)
+    return 0;
+  data_fill(iface, (struct genx_test *)iface->test.i.data.list, Gen_Seed + gen);
+  return 1;
+}
+
+/**
+ * write a CSV out as GENXDAT1; reads it twice, holds DATA_BUF values
+ * per column
+ */
+int data_csv2bin(const char *csv, const char *out)
+{
+  static u32 buf[5][DATA_BUF];
+  struct data_hdr h;
+  struct genx_test t;
+  struct csv c;
+  off_t col;
+  u32 fill = 0,
+      row = 0,
+      w, i, ncol;
+  int r;
+  FILE *f;
+  if (!csv_open(&c, csv))
+    return 0;
+  memset(&h, 0, sizeof h);
+  memcpy(h.magic, DATA_MAGIC, sizeof h.magic);
+  h.cols = csv_inputs(&c);
+  h.flags = c.wcol < c.cols ? DATA_WEIGHT : 0;
+  while (1 == (r = csv_next(&c, &t, &w)))
+    h.rows++;
+  if (r < 0) {
+    fclose(c.f);
+    return 0;
+  }
+  fclose(c.f);
+  if (!csv_open(&c, csv))
+    return 0;
+  f = fopen(out, "wb");
+  if (NULL == f) {
+    perror(out);
+    fclose(c.f);
+    return 0;
+  }
+  ncol = h.cols + 1 + !!(h.flags & DATA_WEIGHT);
+  col = ((off_t)h.rows * (off_t)sizeof(u32) + DATA_ALIGN - 1) & ~(off_t)(DATA_ALIGN - 1);
+  fwrite(&h, sizeof h, 1, f);
+  for (;;) {
+    r = csv_next(&c, &t, &w);
+    if (1 == r) {
+      for (i = 0; i < h.cols; i++)
+        buf[i][fill] = t.in[i];
+      buf[i][fill] = t.out;
+      buf[i + 1][fill] = w;
+      fill++;
+    }
+    if (DATA_BUF == fill || (1 != r && fill)) {
+      for (i = 0; i < ncol; i++) {
+        fseeko(f, (off_t)ALIGN(sizeof h) + (off_t)i * col + (off_t)row * (off_t)sizeof(u32), SEEK_SET);
+        fwrite(buf[i], sizeof(u32), fill, f);
+      }
+      row += fill;
+      fill = 0;
+    }
+    if (1 != r)
+      break;
+  }
+  fclose(c.f);
+  if (fclose(f) || r < 0) {
+    if (r >= 0)
+      perror(out);
+    return 0;
+  }
+  printf("%s: %" PRIu32 " rows, %" PRIu32 " input%s%s\n", out, h.rows, h.cols,
+    1 == h.cols ? "" : "s", h.flags & DATA_WEIGHT ? ", weighted" : "");
+  return 1;
+}
+
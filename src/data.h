@@ -0,0 +1,66 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * test tables from outside the module: a CSV file, or a GENXDAT1 file
+ * genx-data converted from one, mapped just long enough to sample
+ * its columns into rows; or built from a v2 module's callbacks
+ */
+
+#ifndef DATA_H
+#define DATA_H
+
+#include <stddef.h>
+#include "typ.h"
+#include "gen.h"
+
+/*
+ * GENXDAT1: this header, then the columns in[0] .. in[cols-1], out
+ * and, with DATA_WEIGHT, weight; rows u32s each, every column
+ * starting on a DATA_ALIGN boundary
+ */
+#define DATA_MAGIC  "GENXDAT1"
+#define DATA_ALIGN  64
+#define DATA_WEIGHT 0x1 /* flags: a weight column follows out */
+
+struct data_hdr {
+  char magic[8];
+  u32  rows,
+       cols,  /* inputs per row, 1..3 */
+       flags,
+       pad;
+};
+
+/* column c of row i is in[c][i]; weight is NULL when every row counts once */
+struct data {
+  u32        rows,
+             cols;
+  const u32 *in[3],
+            *out,
+            *weight;
+  void      *map;
+  size_t     maplen;
+};
+
+/*
+ * genx keeps at most this many rows of a bigger set, sampled evenly
+ * at random; --data-rows
+ */
+#define DATA_ROWS 65536
+
+extern u32 Data_Rows;
+
+int  data_open(struct data *, const char *path);
+void data_close(struct data *);
+int  data_load(genx_iface *, const char *path, u32 max, u32 seed);
+int  data_csv2bin(const char *csv, const char *out);
+int  data_gen(genx_iface *, u32 seed);
+int  data_refresh(genx_iface *, u32 gen);
+
+#endif
+
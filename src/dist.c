@@ -0,0 +1,175 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * every backend accumulates in 64 bits, so no sum of u32 distances
+ * over fewer than 2^32 tests can wrap and the caller only has to
+ * saturate once at the end. SIMD versions are compiled with target
+ * attributes and picked at runtime, so the build needs no -mavx2
+ * and the binary still runs on older cpus.
+ */
+
+#include <stdlib.h>
+#include "typ.h"
+#include "run.h"
+#include "dist.h"
+
+#if defined(__GNUC__) && __GNUC__ >= 8 && (defined(__i386__) || defined(__x86_64__))
+# define DIST_SIMD
+# include <immintrin.h>
+#endif
+
+static int dist_scalar_ok(void)
+{
+  return 1;
+}
+
+static u64 dist_bit_scalar(const u32 *got, const u32 *want, u32 n)
+{
+  u64 sum = 0;
+  u32 i;
+  for (i = 0; i < n; i++)
+    sum += popcnt(got[i] ^ want[i]);
+  return sum;
+}
+
+static u64 dist_alg_scalar(const u32 *got, const u32 *want, u32 n)
+{
+  u64 sum = 0;
+  u32 i;
+  for (i = 0; i < n; i++)
+    sum += alg_diff(want[i], got[i]);
+  return sum;
+}
+
+#ifdef DIST_SIMD
+
+static int dist_avx2_ok(void)
+{
+  return __builtin_cpu_supports("avx2");
+}
+
+/* no _mm256_extract_epi64 in 32-bit mode */
+__attribute__((target("avx2")))
+static inline u64 dist_hsum256(__m256i v)
+{
+  u64 q[4];
+  _mm256_storeu_si256((__m256i *)q, v);
+  return q[0] + q[1] + q[2] + q[3];
+}
+
+/**
+ * popcnt by nibble lookup (vpshufb), bytes summed into 64-bit lanes
+ * with vpsadbw
+ */
+__attribute__((target("avx2")))
+static u64 dist_bit_avx2(const u32 *got, const u32 *want, u32 n)
+{
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4),
+                low = _mm256_set1_epi8(0x0f),
+                zero = _mm256_setzero_si256();
+  __m256i acc = zero;
+  u64 sum;
+  u32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(got + i)),
+                                 _mm256_loadu_si256((const __m256i *)(want + i))),
+            c = _mm256_add_epi8(
+                  _mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                  _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+    acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, zero));
+  }
+  sum = dist_hsum256(acc);
+  return sum + dist_bit_scalar(got + i, want + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static u64 dist_alg_avx2(const u32 *got, const u32 *want, u32 n)
+{
+  __m256i acc = _mm256_setzero_si256();
+  u64 sum;
+  u32 i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i d = _mm256_abs_epi32(_mm256_sub_epi32(
+                  _mm256_loadu_si256((const __m256i *)(want + i)),
+                  _mm256_loadu_si256((const __m256i *)(got + i))));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(d)));
+    acc = _mm256_add_epi64(acc, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(d, 1)));
+  }
+  sum = dist_hsum256(acc);
+  return sum + dist_alg_scalar(got + i, want + i, n - i);
+}
+
+static int dist_avx512_ok(void)
+{
+  return __builtin_cpu_supports("avx512f")
+      && __builtin_cpu_supports("avx512vpopcntdq");
+}
+
+/**
+ * VPOPCNTQ counts both u32 lanes of a qword at once; the tail is a
+ * masked load so there's no scalar loop
+ */
+__attribute__((target("avx512f,avx512vpopcntdq")))
+static u64 dist_bit_avx512(const u32 *got, const u32 *want, u32 n)
+{
+  __m512i acc = _mm512_setzero_si512();
+  u32 i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512i x = _mm512_xor_si512(_mm512_loadu_si512(got + i),
+                                 _mm512_loadu_si512(want + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+  }
+  if (i < n) {
+    const __mmask16 m = (__mmask16)((1U << (n - i)) - 1);
+    __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi32(m, got + i),
+                                 _mm512_maskz_loadu_epi32(m, want + i));
+    acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+  }
+  return (u64)_mm512_reduce_add_epi64(acc);
+}
+
+__attribute__((target("avx512f")))
+static u64 dist_alg_avx512(const u32 *got, const u32 *want, u32 n)
+{
+  __m512i acc = _mm512_setzero_si512();
+  u32 i = 0;
+  for (; i < n; i += 16) {
+    const __mmask16 m = n - i >= 16 ? 0xFFFF : (__mmask16)((1U << (n - i)) - 1);
+    __m512i d = _mm512_abs_epi32(_mm512_sub_epi32(
+                  _mm512_maskz_loadu_epi32(m, want + i),
+                  _mm512_maskz_loadu_epi32(m, got + i)));
+    acc = _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm512_castsi512_si256(d)));
+    acc = _mm512_add_epi64(acc, _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(d, 1)));
+  }
+  return (u64)_mm512_reduce_add_epi64(acc);
+}
+
+#endif /* DIST_SIMD */
+
+const struct dist Dist[] = {
+#ifdef DIST_SIMD
+  { "avx512", dist_avx512_ok, dist_bit_avx512, dist_alg_avx512 },
+  { "avx2",   dist_avx2_ok,   dist_bit_avx2,   dist_alg_avx2   },
+#endif
+  { "scalar", dist_scalar_ok, dist_bit_scalar, dist_alg_scalar },
+  { NULL,     NULL,           NULL,            NULL            }
+};
+
+const struct dist * dist_best(void)
+{
+  const struct dist *d = Dist;
+#ifdef DIST_SIMD
+  __builtin_cpu_init();
+#endif
+  while (!d->ok())
+    d++;
+  return d;
+}
+
@@ -0,0 +1,34 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * whole-table distance between collected candidate outputs and the
+ * expected outputs, reduced with the widest SIMD this cpu has
+ */
+
+#ifndef DIST_H
+#define DIST_H
+
+#include "typ.h"
+
+typedef u64 (*dist_fn)(const u32 *got, const u32 *want, u32 n);
+
+struct dist {
+  const char *name;
+  int       (*ok)(void);  /* can this cpu run it? */
+  dist_fn     bit,        /* sum of popcnt(got ^ want)        */
+              alg;        /* sum of alg_diff(want, got)       */
+};
+
+/* best first, terminated by a NULL name; the last one always works */
+extern const struct dist Dist[];
+
+const struct dist * dist_best(void);
+
+#endif
+
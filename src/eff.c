@@ -0,0 +1,216 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * most random genotypes never get the input into eax, or clobber it
+ * with a constant before returning; every test then produces the same
+ * output. a forward pass over the ops tracks which registers may hold
+ * something derived from eax/ebx/ecx; if eax is clean at ret one call
+ * tells us everything.
+ *
+ * the pass must never call a dependent candidate constant: unknown
+ * ops, jumps on tainted flags and anything reading the stack give up.
+ * ops that leave some flags undefined or untouched are EFF_KEEPF:
+ * the flags that come out may be the ones that went in.
+ * @ref: #1, #2 per-instruction "Flags Affected"
+ */
+
+#include "typ.h"
+#include "x86.h"
+#include "eff.h"
+
+extern const struct x86 X86[X86_COUNT];
+
+#define F     EFF_FLAGS
+
+const struct eff Eff[X86_COUNT] = {
+  /*                  read                      written                  flag */
+  [JA_32]         = { F,                        0,                       0 },
+  [JAE_32]        = { F,                        0,                       0 },
+  [JB_32]         = { F,                        0,                       0 },
+  [JBE_32]        = { F,                        0,                       0 },
+  [JE_32]         = { F,                        0,                       0 },
+  [JG_32]         = { F,                        0,                       0 },
+  [JGE_32]        = { F,                        0,                       0 },
+  [JL_32]         = { F,                        0,                       0 },
+  [JLE_32]        = { F,                        0,                       0 },
+  [JNE_32]        = { F,                        0,                       0 },
+  [JNO_32]        = { F,                        0,                       0 },
+  [JNP_32]        = { F,                        0,                       0 },
+  [JNS_32]        = { F,                        0,                       0 },
+  [JO_32]         = { F,                        0,                       0 },
+  [JP_32]         = { F,                        0,                       0 },
+  [JS_32]         = { F,                        0,                       0 },
+#ifdef X86_USE_INT
+  /* 0x83 with a random reg field: add/or/adc/sbb */
+  [ADD_IMM8]      = { EFF_RM | F,               EFF_RM | F,              0 },
+  [ADD_R32]       = { EFF_RM | EFF_REG,         EFF_RM | F,              0 },
+  [IMUL_IMM]      = { EFF_RM,                   EFF_REG | F,             EFF_KEEPF },
+  [IMUL_R32]      = { EFF_REG | EFF_RM,         EFF_REG | F,             EFF_KEEPF },
+  [MOV_R32]       = { EFF_RM,                   EFF_REG,                 EFF_NOP },
+  [XCHG_R32]      = { EFF_REG | EFF_RM,         EFF_REG | EFF_RM,        EFF_NOP },
+  [XOR_R32]       = { EFF_REG | EFF_RM,         EFF_REG | F,             EFF_SAME },
+  [XOR_IMM32]     = { EFF_RM,                   EFF_RM | F,              0 },
+  [XADD_R32]      = { EFF_REG | EFF_RM,         EFF_REG | EFF_RM | F,    0 },
+  [SHR_IMM8]      = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [SHL_IMM8]      = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [OR_R32]        = { EFF_REG | EFF_RM,         EFF_REG | F,             0 },
+  [AND_R32]       = { EFF_REG | EFF_RM,         EFF_REG | F,             0 },
+  [AND_IMM32]     = { EFF_RM,                   EFF_RM | F,              0 },
+  [NEG_R32]       = { EFF_RM,                   EFF_RM | F,              0 },
+  [NOT_R32]       = { EFF_RM,                   EFF_RM,                  0 },
+  [SUB_R32]       = { EFF_RM | EFF_REG,         EFF_RM | F,              EFF_SAME },
+  [SUB_IMM32]     = { EFF_RM,                   EFF_RM | F,              0 },
+  [BT_R32]        = { EFF_RM | EFF_REG,         F,                       EFF_KEEPF },
+  [BT_IMM8]       = { EFF_RM,                   F,                       EFF_KEEPF },
+  /* destination undefined, in practice untouched, for a zero source */
+  [BSF_R32]       = { EFF_REG | EFF_RM,         EFF_REG | F,             EFF_KEEPF },
+  [BSR_R32]       = { EFF_REG | EFF_RM,         EFF_REG | F,             EFF_KEEPF },
+  [BTC_R32]       = { EFF_RM | EFF_REG,         EFF_RM | F,              EFF_KEEPF },
+  [BTC_IMM8]      = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [BTR_R32]       = { EFF_RM | EFF_REG,         EFF_RM | F,              EFF_KEEPF },
+  [BTR_IMM8]      = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [CMP_R32]       = { EFF_RM | EFF_REG,         F,                       EFF_SAME },
+  [CMP_IMM32]     = { EFF_RM,                   F,                       0 },
+  [CMPXCHG_R32]   = { EFF_EAX | EFF_RM | EFF_REG,EFF_EAX | EFF_RM | F,    0 },
+  [RCL_IMM8]      = { EFF_RM | F,               EFF_RM | F,              0 },
+  [RCR_IMM8]      = { EFF_RM | F,               EFF_RM | F,              0 },
+  /* 0xc1 with a random reg field: rol/ror/rcl/rcr */
+  [ROL_IMM8]      = { EFF_RM | F,               EFF_RM | F,              0 },
+  [ROR_IMM8]      = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [CMOVA]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVB]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVBE]        = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVC]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVE]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVG]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVGE]        = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVL]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVLE]        = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVO]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVP]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVPE]        = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVPO]        = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVS]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  [CMOVZ]         = { EFF_REG | EFF_RM | F,     EFF_REG,                 EFF_NOP },
+  /* CF untouched */
+  [INC]           = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [DEC]           = { EFF_RM,                   EFF_RM | F,              EFF_KEEPF },
+  [POPCNT_R32]    = { EFF_RM,                   EFF_REG | F,             0 },
+  [LZCNT_R32]     = { EFF_RM,                   EFF_REG | F,             EFF_KEEPF },
+  [TZCNT_R32]     = { EFF_RM,                   EFF_REG | F,             EFF_KEEPF },
+  [ADCX_R32]      = { EFF_REG | EFF_RM | F,     EFF_REG | F,             0 },
+  [ADOX_R32]      = { EFF_REG | EFF_RM | F,     EFF_REG | F,             0 },
+  [ANDN]          = { EFF_VVVV | EFF_RM,        EFF_REG | F,             EFF_KEEPF },
+  [BLSR]          = { EFF_RM,                   EFF_VVVV | F,            EFF_KEEPF },
+  [BLSMSK]        = { EFF_RM,                   EFF_VVVV | F,            EFF_KEEPF },
+  [BLSI]          = { EFF_RM,                   EFF_VVVV | F,            EFF_KEEPF },
+  [BEXTR]         = { EFF_RM | EFF_VVVV,        EFF_REG | F,             EFF_KEEPF },
+  [BZHI]          = { EFF_RM | EFF_VVVV,        EFF_REG | F,             EFF_KEEPF },
+  [PDEP]          = { EFF_VVVV | EFF_RM,        EFF_REG,                 0 },
+  [PEXT]          = { EFF_VVVV | EFF_RM,        EFF_REG,                 0 },
+  [SHLX]          = { EFF_RM | EFF_VVVV,        EFF_REG,                 0 },
+  [SHRX]          = { EFF_RM | EFF_VVVV,        EFF_REG,                 0 },
+  [SARX]          = { EFF_RM | EFF_VVVV,        EFF_REG,                 0 },
+  [RORX]          = { EFF_RM,                   EFF_REG,                 0 },
+#endif
+  [LEA_8EBP_EAX]  = { EFF_STACK,                EFF_EAX,                 0 },
+  /* only the low byte of r/m is written */
+  [SETA]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETAE]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETB]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETBE]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETE]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETG]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETGE]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETL]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETLE]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETNE]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETNS]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETO]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETP]          = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETPO]         = { EFF_RM | F,               EFF_RM,                  0 },
+  [SETS]          = { EFF_RM | F,               EFF_RM,                  0 },
+  /*
+   * x87 ops aren't listed; a genotype using one is never constant.
+   * CMOVNA..CMOVNZ, BSWAP_EDX and IDIV_R32 are #if 0'd out of x86.h
+   * (the cmovn* encodings are those of cmova..cmovz above), so they
+   * have no entry
+   */
+};
+
+#undef F
+
+#define T_EAX   EFF_T_EAX
+#define T_ECX   EFF_T_ECX
+#define T_EBX   EFF_T_EBX
+#define T_FLAGS EFF_T_FLAGS
+
+/**
+ * @return 1 if g's output is the same for every input; 0 if it may not be
+ */
+int eff_const(const genotype *g)
+{
+  struct {
+    u32 at,    /* byte offset of the jump target */
+        taint;
+  } jmp[g->len]; /* at most one per op */
+  /* shim_i passes the input in eax/ebx/ecx and zeroes the rest */
+  u32 taint = T_EAX | T_EBX | T_ECX,
+      njmp = 0,
+      pos = 0,
+      i, j;
+  for (i = 0; i < GEN_PREFIX_LEN; i++)
+    pos += chromo_bytes(g->chromo + i);
+  for (; i < g->len; i++) {
+    const struct op *o = g->chromo + i;
+    const struct eff *e = Eff + o->x86;
+    u32 rd, wr;
+    /* join the forward jumps landing here */
+    for (j = 0; j < njmp; ) {
+      if (jmp[j].at > pos) {
+        j++;
+        continue;
+      }
+      if (jmp[j].at < pos)
+        return 0; /* into the middle of an op; shouldn't happen */
+      taint |= jmp[j].taint;
+      jmp[j] = jmp[--njmp];
+    }
+    pos += chromo_bytes(o);
+    if (i >= g->len - GEN_SUFFIX_LEN)
+      continue;
+    if (0 == (e->rd | e->wr) || (e->rd & EFF_STACK))
+      return 0;
+    rd = eff_regs(o, e->rd);
+    wr = eff_regs(o, e->wr);
+    if (X86[o->x86].jcc) {
+      /* a branch on the input is control dependence; don't go there */
+      if (taint & T_FLAGS)
+        return 0;
+      if (njmp == sizeof jmp / sizeof jmp[0])
+        return 0;
+      jmp[njmp].at = pos + *(const s32 *)o->data;
+      jmp[njmp].taint = taint;
+      njmp++;
+      continue;
+    }
+    if ((e->flag & (EFF_SAME | EFF_NOP)) && (o->modrm >> 3 & 7) == (o->modrm & 7)) {
+      if (e->flag & EFF_SAME)
+        taint &= ~wr;
+    } else {
+      u32 keep = (e->flag & EFF_KEEPF) ? taint & T_FLAGS : 0;
+      if (taint & rd)
+        taint |= wr;
+      else
+        taint = (taint & ~wr) | (keep & wr);
+    }
+  }
+  return 0 == njmp && !(taint & T_EAX);
+}
+
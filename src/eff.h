@@ -0,0 +1,70 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * static register effects of each op, and a taint pass over a
+ * genotype that proves its output can't depend on its input
+ */
+
+#ifndef EFF_H
+#define EFF_H
+
+#include "typ.h"
+#include "gen.h"
+
+/* operand roles an op reads or writes */
+#define EFF_REG   0x01 /* modr/m reg field                     */
+#define EFF_RM    0x02 /* modr/m r/m field                     */
+#define EFF_VVVV  0x04 /* VEX.vvvv, the register in data[0]    */
+#define EFF_EAX   0x08 /* implicit eax                         */
+#define EFF_FLAGS 0x10 /* read: the result depends on them     */
+#define EFF_STACK 0x20 /* reads esp/ebp: differs between calls */
+
+/* op flags */
+#define EFF_SAME  0x01 /* reg == r/m makes the result constant */
+#define EFF_NOP   0x02 /* reg == r/m makes it a no-op          */
+#define EFF_KEEPF 0x04 /* some flags are left as they were     */
+
+/* eff_regs() bits: one per register number, as in modr/m, and the flags */
+#define EFF_T_EAX   (1 << 0)
+#define EFF_T_ECX   (1 << 1)
+#define EFF_T_EBX   (1 << 3)
+#define EFF_T_FLAGS (1 << 8)
+
+struct eff {
+  u8 rd,
+     wr,
+     flag;
+};
+
+extern const struct eff Eff[];
+
+/**
+ * the registers behind an op's operand roles
+ */
+static inline u32 eff_regs(const struct op *o, u8 role)
+{
+  u32 t = 0;
+  if (role & EFF_REG)
+    t |= 1 << ((o->modrm >> 3) & 7);
+  if (role & EFF_RM)
+    t |= 1 << (o->modrm & 7);
+  if (role & EFF_VVVV)
+    t |= 1 << (o->data[0] & 7);
+  if (role & EFF_EAX)
+    t |= EFF_T_EAX;
+  if (role & EFF_FLAGS)
+    t |= EFF_T_FLAGS;
+  return t;
+}
+
+/* call after gen_compile(); it resolves the jump offsets we follow */
+int eff_const(const genotype *);
+
+#endif
+
@@ -0,0 +1,321 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * the alphabet is every enabled non-jump op with each register choice
+ * gen_modrm() could make and, for immediates, each Imm[] value the
+ * module allows. a program is skipped without running it if
+ *
+ *  - two adjacent ops don't touch each other's registers or flags and
+ *    are out of alphabet order: the swapped program is tried instead
+ *  - an op writes nothing read later or returned in eax: the program
+ *    without it is one shorter and was already tried
+ *
+ * threads take the first op off a shared counter; the match with the
+ * lowest first op wins, so the result doesn't depend on -j. a thread
+ * tries the test row that last rejected a candidate before the rest.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "typ.h"
+#include "x86.h"
+#include "gen.h"
+#include "run.h"
+#include "mon.h"
+#include "eff.h"
+#include "enumerate.h"
+
+extern const struct x86 X86[X86_COUNT];
+
+u32 Enumerate = 0;
+u32 Enumerate_Threads = 0;
+
+#ifndef X86_USE_FLOAT
+
+/* immediates tried; bit counts, masks and their neighbours */
+static const u32 Imm[] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 15, 16, 24, 31, 32, 63, 64,
+  0x7F, 0x80, 0xFF, 0x100, 0x7FFF, 0x8000, 0xFFFF
+};
+
+static struct sym {
+  struct op op;
+  u32 rd,
+      wr,
+      kill,  /* registers wr leaves nothing of */
+      known; /* Eff[] has it */
+} *Sym = NULL;
+static u32 Sym_Len = 0;
+
+static struct {
+  const genx_iface *iface;
+  u32               len;
+  volatile u32      next,  /* first op not yet handed out        */
+                    found; /* lowest first op with a match so far */
+  pthread_mutex_t   lock;
+  struct op         best[ENUMERATE_MAX];
+} E;
+
+struct enum_thread {
+  pthread_t th;
+  u8       *code;
+  genotype  g;
+  u32       pick[ENUMERATE_MAX], /* Sym[] index at each position */
+            first,
+            last;  /* test row that last rejected a candidate */
+  u64       tried;
+};
+
+static void sym_add(const struct op *o)
+{
+  const struct eff *e = Eff + o->x86;
+  struct sym *s;
+  if (0 == Sym_Len % 256) {
+    Sym = realloc(Sym, (Sym_Len + 256) * sizeof *Sym);
+    assert(Sym);
+  }
+  s = Sym + Sym_Len++;
+  s->op = *o;
+  s->known = 0 != (e->rd | e->wr);
+  s->rd = eff_regs(o, e->rd);
+  s->wr = eff_regs(o, e->wr);
+  s->kill = s->wr & ~(e->flag & EFF_KEEPF ? EFF_T_FLAGS : 0);
+  if ((e->flag & EFF_SAME) && (o->modrm >> 3 & 7) == (o->modrm & 7))
+    s->rd = 0;
+}
+
+/**
+ * every op we may place at a position, in a fixed order
+ */
+static void sym_build(const genx_iface *iface)
+{
+  u32 i, m, v, c;
+  Sym_Len = 0;
+  for (i = X86_FIRST; i < X86_COUNT; i++) {
+    const struct x86 *x = X86 + i;
+    const u32 nm = x->modrmlen ? (R == x->modrm ? 16 : 4) : 1,
+              nv = x->vex ? 4 : 1,
+              nc = x->immlen ? sizeof Imm / sizeof Imm[0] : 1;
+    if (0 == X86_Weight[i] || x->jcc)
+      continue;
+    for (m = 0; m < nm; m++) {
+      struct op o;
+      memset(&o, 0, sizeof o);
+      o.x86 = (u8)i;
+      if (x->modrmlen) /* e[acdb]x only, like gen_modrm() */
+        o.modrm = R == x->modrm ? 0xC0 | (m >> 2) << 3 | (m & 3)
+                                : 0xC0 | x->modrm << 3 | m;
+      if ((Eff[i].flag & EFF_NOP) && (o.modrm >> 3 & 7) == (o.modrm & 7))
+        continue;
+      for (v = 0; v < nv; v++) {
+        o.data[0] = (u8)v;
+        for (c = 0; c < nc; c++) {
+          if (x->immlen) {
+            if (Imm[c] > iface->test.i.max_const || (1 == x->immlen && Imm[c] > 0xFF))
+              continue;
+            memcpy(o.data, Imm + c, sizeof o.data);
+          }
+          sym_add(&o);
+        }
+      }
+    }
+  }
+}
+
+/* may a come right before b? */
+static int sym_order(u32 a, u32 b)
+{
+  const struct sym *x = Sym + a,
+                   *y = Sym + b;
+  return a <= b || !x->known || !y->known
+      || (x->wr & (y->rd | y->wr)) || (y->wr & x->rd);
+}
+
+/* does some op write only what nobody reads? */
+static int enum_dead(const struct enum_thread *t)
+{
+  u32 live = EFF_T_EAX,
+      d;
+  for (d = E.len; d--; ) {
+    const struct sym *s = Sym + t->pick[d];
+    if (!s->known)
+      return 0;
+    if (0 == (s->wr & live))
+      return 1;
+    live = (live & ~s->kill) | s->rd;
+  }
+  return 0;
+}
+
+static int enum_test(struct enum_thread *t)
+{
+  const struct genx_test *r = E.iface->test.i.data.list;
+  const u32 n = E.iface->test.i.data.len;
+  u32 i;
+  t->g.len = GEN_PREFIX_LEN + E.len;
+  GEN_SUFFIX(&t->g);
+  gen_compile(&t->g, t->code, X86_BUFLEN);
+  t->tried++;
+  if (shim_i(t->code, r[t->last].in[0], r[t->last].in[1], r[t->last].in[2]) != r[t->last].out)
+    return 0;
+  for (i = 0; i < n; i++) {
+    if (i != t->last && shim_i(t->code, r[i].in[0], r[i].in[1], r[i].in[2]) != r[i].out) {
+      t->last = i;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * fill positions d.. of t's program
+ * @return 1 on a match
+ */
+static int enum_walk(struct enum_thread *t, u32 d)
+{
+  u32 i;
+  if (d == E.len)
+    return !enum_dead(t) && enum_test(t);
+  if (E.found < t->first)
+    return 0;
+  for (i = 0; i < Sym_Len; i++) {
+    if (!sym_order(t->pick[d - 1], i))
+      continue;
+    t->pick[d] = i;
+    t->g.chromo[GEN_PREFIX_LEN + d] = Sym[i].op;
+    if (enum_walk(t, d + 1))
+      return 1;
+  }
+  return 0;
+}
+
+static void * enum_thread(void *arg)
+{
+  struct enum_thread *t = arg;
+  u32 i;
+  for (;;) {
+    t->first = __sync_fetch_and_add(&E.next, 1);
+    if (t->first >= Sym_Len || t->first > E.found)
+      break;
+    t->pick[0] = t->first;
+    t->g.chromo[GEN_PREFIX_LEN] = Sym[t->first].op;
+    if (!enum_walk(t, 1))
+      continue;
+    pthread_mutex_lock(&E.lock);
+    if (t->first < E.found) {
+      E.found = t->first;
+      for (i = 0; i < E.len; i++)
+        E.best[i] = Sym[t->pick[i]].op;
+    }
+    pthread_mutex_unlock(&E.lock);
+  }
+  return NULL;
+}
+
+/**
+ * try every program of up to Enumerate ops, shortest first
+ * @return non-zero if best got a match the module's done() accepts
+ */
+int enumerate(genoscore *best, const genx_iface *iface)
+{
+  struct enum_thread *t;
+  u32 threads = cpu_count(Enumerate_Threads),
+      maxlen = Enumerate,
+      len,
+      i;
+  time_t t0 = time(NULL);
+  int solved = 0;
+  if (SCORE_HASH == iface->test.i.score || SCORE_MPH == iface->test.i.score) {
+    printf("enumerate: nothing to match for a hash\n");
+    return 0;
+  }
+  if (maxlen > iface->opt.chromo_max)
+    maxlen = iface->opt.chromo_max;
+  if (maxlen > ENUMERATE_MAX)
+    maxlen = ENUMERATE_MAX;
+  sym_build(iface);
+  printf("enumerate: %" PRIu32 " ops to choose from, up to %" PRIu32 " long, %" PRIu32 " threads\n",
+    Sym_Len, maxlen, threads);
+  t = calloc(threads, sizeof *t);
+  assert(t);
+  for (i = 0; i < threads; i++) {
+    if (NULL == (t[i].code = code_page()))
+      abort();
+    t[i].g.chromo = malloc((GEN_PREFIX_LEN + ENUMERATE_MAX + GEN_SUFFIX_LEN) * sizeof *t[i].g.chromo);
+    assert(t[i].g.chromo);
+    GEN_PREFIX(&t[i].g);
+  }
+  E.iface = iface;
+  pthread_mutex_init(&E.lock, NULL);
+  for (len = 1; len <= maxlen; len++) {
+    u64 tried = 0;
+    E.len = len;
+    E.next = 0;
+    E.found = 0xFFFFFFFFU;
+    printf("enumerate: length %" PRIu32 "...", len);
+    fflush(stdout);
+    for (i = 0; i < threads; i++)
+      if (pthread_create(&t[i].th, NULL, enum_thread, t + i)) {
+        perror("pthread_create");
+        abort();
+      }
+    for (i = 0; i < threads; i++) {
+      pthread_join(t[i].th, NULL);
+      mon_worker(i)->evals += t[i].tried;
+      tried += t[i].tried;
+      t[i].tried = 0;
+    }
+    printf("%llu run (%lus)", (unsigned long long)tried, (unsigned long)(time(NULL) - t0));
+    if (0xFFFFFFFFU == E.found) {
+      printf(", no match\n");
+      mon_publish(len, GENOSCORE_WORST, 0);
+      continue;
+    }
+    printf(", match\n");
+    best->geno.len = GEN_PREFIX_LEN;
+    GEN_PREFIX(&best->geno);
+    memcpy(best->geno.chromo + GEN_PREFIX_LEN, E.best, len * sizeof E.best[0]);
+    best->geno.len += len;
+    GEN_SUFFIX(&best->geno);
+    best->geno.mut.shape = 0;
+    best->geno.mut.nop = 0;
+    best->cyc = GENOSCORE_NOCYC;
+    score(best, iface, 0);
+    gen_dump(&best->geno, stdout);
+    mon_publish(len, GENOSCORE_SCORE(best), best->geno.len);
+    solved = (*iface->test.i.done)(best);
+    if (!solved)
+      printf("enumerate: module's done() wants more, evolving\n");
+    break;
+  }
+  pthread_mutex_destroy(&E.lock);
+  for (i = 0; i < threads; i++) {
+    code_page_free(t[i].code);
+    free(t[i].g.chromo);
+  }
+  free(t);
+  return solved;
+}
+
+#else
+
+int enumerate(genoscore *best, const genx_iface *iface)
+{
+  (void)best;
+  (void)iface;
+  printf("enumerate: integer ops only\n");
+  return 0;
+}
+
+#endif
+
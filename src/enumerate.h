@@ -0,0 +1,29 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * --enumerate=N: before evolving, try every program of 1, 2 .. N ops
+ * over the enabled X86[] ops, their registers and a small constant
+ * pool; the first length with a match gives the shortest program
+ */
+
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define ENUMERATE_MAX 8 /* past 3 or so it won't finish anyway */
+
+extern u32 Enumerate;         /* longest program tried; 0 is off */
+extern u32 Enumerate_Threads; /* -j; 0 is one per online cpu     */
+
+int enumerate(genoscore *, const genx_iface *);
+
+#endif
+
@@ -0,0 +1,320 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * --export=PREFIX writes, for the best genotype:
+ *
+ *   PREFIX.s        GNU as source, one .byte line per op
+ *   PREFIX.c        the same as top-level asm in C, with a prototype
+ *   PREFIX.o        PREFIX.s assembled with $CC -m32 -c
+ *   PREFIX-bench.c  checks PREFIX.o against the module's test.i.func
+ *                   on random inputs, then times both; not written
+ *                   for modules without a func
+ *
+ * the exported function is cdecl, u32 f(u32 a, u32 b, u32 c). a small
+ * wrapper does what shim_i() does: a, b, c into eax, ebx, ecx, edx,
+ * esi, edi zeroed, callee-saved registers restored. the evolved bytes
+ * are emitted verbatim so jumps keep their offsets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <unistd.h>
+#include "typ.h"
+#include "x86.h"
+#include "gen.h"
+#include "export.h"
+
+#ifndef GENX_SRC /* where gen.h is, for the bench's -I; set by the Makefile */
+# define GENX_SRC "."
+#endif
+
+extern const struct x86 X86[X86_COUNT];
+
+/**
+ * C identifier from the last path component of prefix
+ */
+static void export_sym(const char *prefix, char *sym, size_t len)
+{
+  const char *base = strrchr(prefix, '/');
+  size_t i = 0;
+  base = base ? base + 1 : prefix;
+  if (isdigit((unsigned char)*base) && i + 1 < len)
+    sym[i++] = '_';
+  for (; *base && i + 1 < len; base++)
+    sym[i++] = isalnum((unsigned char)*base) ? *base : '_';
+  sym[i] = '\0';
+}
+
+/**
+ * the function in GNU as syntax, every line wrapped in pre/post so
+ * the same text serves the .s and the C file
+ */
+static void export_asm(FILE *f, const char *pre, const char *post,
+                       const char *sym, const genotype *g, const u8 *code)
+{
+  u32 i, j,
+      off = 0;
+  fprintf(f, "%s.text%s", pre, post);
+  fprintf(f, "%s.globl %s%s", pre, sym, post);
+  fprintf(f, "%s.type %s, @function%s", pre, sym, post);
+  fprintf(f, "%s%s:%s", pre, sym, post);
+  fprintf(f, "%s  push %%ebx%s", pre, post);
+  fprintf(f, "%s  push %%esi%s", pre, post);
+  fprintf(f, "%s  push %%edi%s", pre, post);
+  fprintf(f, "%s  mov 16(%%esp), %%eax%s", pre, post);
+  fprintf(f, "%s  mov 20(%%esp), %%ebx%s", pre, post);
+  fprintf(f, "%s  mov 24(%%esp), %%ecx%s", pre, post);
+  fprintf(f, "%s  xor %%edx, %%edx%s", pre, post);
+  fprintf(f, "%s  xor %%esi, %%esi%s", pre, post);
+  fprintf(f, "%s  xor %%edi, %%edi%s", pre, post);
+  fprintf(f, "%s  call %s_body%s", pre, sym, post);
+  fprintf(f, "%s  pop %%edi%s", pre, post);
+  fprintf(f, "%s  pop %%esi%s", pre, post);
+  fprintf(f, "%s  pop %%ebx%s", pre, post);
+  fprintf(f, "%s  ret%s", pre, post);
+  fprintf(f, "%s%s_body:%s", pre, sym, post);
+  for (i = 0; i < g->len; i++) {
+    u32 len = chromo_bytes(g->chromo + i);
+    fprintf(f, "%s  .byte ", pre);
+    for (j = 0; j < len; j++)
+      fprintf(f, "%s0x%02" PRIx8, j ? "," : "", code[off + j]);
+    fprintf(f, "%*s # ", len < 8 ? (int)(5 * (8 - len)) : 0, "");
+    op_dump(g->chromo + i, f);
+    fprintf(f, "%s", post);
+    off += len;
+  }
+  fprintf(f, "%s.size %s, .-%s%s", pre, sym, sym, post);
+}
+
+/* prefix + ext single-quoted for sh, each ' as '\'' */
+static void export_quote(char *dst, size_t len, const char *prefix, const char *ext)
+{
+  char path[PATH_MAX];
+  const char *p;
+  size_t n = 0;
+  snprintf(path, sizeof path, "%s%s", prefix, ext);
+  dst[n++] = '\'';
+  for (p = path; *p && n + 5 < len; p++) {
+    if ('\'' == *p) {
+      memcpy(dst + n, "'\\''", 4);
+      n += 4;
+    } else {
+      dst[n++] = *p;
+    }
+  }
+  dst[n++] = '\'';
+  dst[n] = '\0';
+}
+
+static FILE * export_open(const char *prefix, const char *ext, char *path, size_t len)
+{
+  FILE *f;
+  snprintf(path, len, "%s%s", prefix, ext);
+  if (NULL == (f = fopen(path, "w")))
+    perror(path);
+  return f;
+}
+
+/**
+ * random inputs are masked to the smallest power-of-2 range that
+ * covers each parameter in the module's tests; a reference written
+ * for bytes is not asked about 0xdeadbeef
+ */
+static void export_masks(const genx_iface *iface, u32 mask[3])
+{
+  u32 i, p;
+  for (p = 0; p < 3; p++) {
+    u32 m = 0;
+    for (i = 0; i < iface->test.i.data.len; i++)
+      m |= iface->test.i.data.list[i].in[p];
+    while (m & (m + 1))
+      m |= m >> 1;
+    mask[p] = m;
+  }
+}
+
+static void export_bench(FILE *f, const char *sym, const char *prefix,
+                         const char *module, const genx_iface *iface)
+{
+  char modpath[PATH_MAX];
+  u32 mask[3];
+  export_masks(iface, mask);
+  if (NULL == realpath(module, modpath))
+    snprintf(modpath, sizeof modpath, "%s", module);
+  fprintf(f,
+"/*\n"
+" * generated by genx --export; head-to-head of %s against the\n"
+" * reference in %s\n"
+" *\n"
+" *   cc -m32 -O2 -I%s %s-bench.c %s.o -ldl -o %s-bench\n"
+" */\n"
+"\n"
+"#include <stdio.h>\n"
+"#include <stdlib.h>\n"
+"#include <time.h>\n"
+"#include <dlfcn.h>\n"
+"#include \"gen.h\"\n"
+"\n"
+"#define CALLS %u\n"
+"\n"
+"u32 %s(u32, u32, u32);\n"
+"\n"
+"int Dump = 0;\n"
+"genx_iface *Iface;\n"
+"\n"
+"static u32 S = 0x9e3779b9;\n"
+"\n"
+"static u32 xorshift(void)\n"
+"{\n"
+"  S ^= S << 13;\n"
+"  S ^= S >> 17;\n"
+"  S ^= S << 5;\n"
+"  return S;\n"
+"}\n"
+"\n"
+"static double now(void)\n"
+"{\n"
+"  struct timespec t;\n"
+"  clock_gettime(CLOCK_MONOTONIC, &t);\n"
+"  return t.tv_sec + t.tv_nsec / 1e9;\n"
+"}\n"
+"\n"
+"int main(void)\n"
+"{\n"
+"  static const u32 Mask[3] = { 0x%08" PRIx32 ", 0x%08" PRIx32 ", 0x%08" PRIx32 " };\n"
+"  static u32 In[1024][4];\n"
+"  volatile u32 sink = 0;\n"
+"  void *h = dlopen(\"%s\", RTLD_NOW);\n"
+"  void *load;\n"
+"  u32 i, bad = 0;\n"
+"  double t, ref, evo;\n"
+"  if (NULL == h || (NULL == (load = dlsym(h, \"load2\")) && NULL == (load = dlsym(h, \"load\")))) {\n"
+"    fprintf(stderr, \"%%s\\n\", dlerror());\n"
+"    return 1;\n"
+"  }\n"
+"  Iface = ((genx_iface *(*)(void))load)();\n"
+"  if (Iface->test.i.init && 0 == Iface->test.i.init()) {\n"
+"    fprintf(stderr, \"init failed\\n\");\n"
+"    return 1;\n"
+"  }\n"
+"  for (i = 0; i < 1024; i++) {\n"
+"    In[i][0] = xorshift() & Mask[0];\n"
+"    In[i][1] = xorshift() & Mask[1];\n"
+"    In[i][2] = xorshift() & Mask[2];\n"
+"    In[i][3] = 0;\n"
+"  }\n"
+"  for (i = 0; i < CALLS / 16; i++) {\n"
+"    const u32 *in = In[i %% 1024];\n"
+"    u32 r = Iface->test.i.func(in),\n"
+"        e = %s(in[0], in[1], in[2]);\n"
+"    if (r != e && bad++ < 8)\n"
+"      printf(\"mismatch (0x%%08x, 0x%%08x, 0x%%08x): ref 0x%%08x evolved 0x%%08x\\n\",\n"
+"        in[0], in[1], in[2], r, e);\n"
+"  }\n"
+"  printf(\"checked %%u random inputs, %%u mismatches\\n\", CALLS / 16, bad);\n"
+"  t = now();\n"
+"  for (i = 0; i < CALLS; i++)\n"
+"    sink += Iface->test.i.func(In[i %% 1024]);\n"
+"  ref = (now() - t) * 1e9 / CALLS;\n"
+"  t = now();\n"
+"  for (i = 0; i < CALLS; i++)\n"
+"    sink += %s(In[i %% 1024][0], In[i %% 1024][1], In[i %% 1024][2]);\n"
+"  evo = (now() - t) * 1e9 / CALLS;\n"
+"  printf(\"reference %%.2f ns/call, evolved %%.2f ns/call, speedup %%.2fx\\n\",\n"
+"    ref, evo, ref / evo);\n"
+"  return bad != 0;\n"
+"}\n",
+    sym, modpath,
+    GENX_SRC, prefix, prefix, prefix,
+    EXPORT_BENCH_CALLS,
+    sym,
+    mask[0], mask[1], mask[2],
+    modpath,
+    sym, sym);
+}
+
+/**
+ * @return non-zero if every file was written; PREFIX.o is best-effort
+ */
+int export_all(const char *prefix, const char *module,
+               const genoscore *best, const genx_iface *iface)
+{
+  char sym[64],
+       path[PATH_MAX],
+       src[4 * PATH_MAX],
+       obj[4 * PATH_MAX],
+       cmd[8 * PATH_MAX + 64];
+  const char *cc = getenv("CC");
+  genotype g;
+  u8 code[4096];
+  FILE *f;
+  export_sym(prefix, sym, sizeof sym);
+  /* gen_compile() fixes up jumps in place, so work on a copy */
+  g.chromo = malloc(best->geno.len * sizeof g.chromo[0]);
+  if (NULL == g.chromo)
+    return 0;
+  gen_copy(&g, &best->geno);
+  gen_compile(&g, code, sizeof code);
+
+  if (NULL == (f = export_open(prefix, ".s", path, sizeof path)))
+    goto fail;
+  fprintf(f, "# generated by genx --export from %s\n", module);
+  fprintf(f, "# score %" PRIt ", %" PRIu32 " ops%s\n", GENOSCORE_SCORE(best),
+    best->geno.len, GENOSCORE_MATCH(best) ? "" : "; NOT A MATCH");
+  fprintf(f, "# u32 %s(u32 a, u32 b, u32 c), cdecl, 32-bit\n", sym);
+  export_asm(f, "", "\n", sym, &g, code);
+  fclose(f);
+  printf("export: %s\n", path);
+
+  if (NULL == (f = export_open(prefix, ".c", path, sizeof path)))
+    goto fail;
+  fprintf(f, "/*\n"
+             " * generated by genx --export from %s\n"
+             " * score %" PRIt ", %" PRIu32 " ops%s; build with -m32\n"
+             " */\n\n"
+             "#include <stdint.h>\n\n"
+             "uint32_t %s(uint32_t a, uint32_t b, uint32_t c);\n\n"
+             "__asm__(\n",
+    module, GENOSCORE_SCORE(best), best->geno.len,
+    GENOSCORE_MATCH(best) ? "" : ", NOT A MATCH", sym);
+  export_asm(f, "  \"", "\\n\"\n", sym, &g, code);
+  fprintf(f, ");\n");
+  fclose(f);
+  printf("export: %s\n", path);
+
+  if (NULL == iface->test.i.func) {
+    printf("export: module has no func, no bench written\n");
+  } else {
+    if (NULL == (f = export_open(prefix, "-bench.c", path, sizeof path)))
+      goto fail;
+    export_bench(f, sym, prefix, module, iface);
+    fclose(f);
+    printf("export: %s\n", path);
+  }
+
+  /* $CC may carry flags, so it goes to sh as is; the paths are quoted */
+  export_quote(src, sizeof src, prefix, ".s");
+  export_quote(obj, sizeof obj, prefix, ".o");
+  snprintf(cmd, sizeof cmd, "%s -m32 -c %s -o %s", cc ? cc : "cc", src, obj);
+  fflush(stdout);
+  if (0 == system(cmd))
+    printf("export: %s.o\n", prefix);
+  else
+    fprintf(stderr, "export: '%s' failed, no object written\n", cmd);
+
+  free(g.chromo);
+  return 1;
+fail:
+  free(g.chromo);
+  return 0;
+}
+
@@ -0,0 +1,25 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * write a genotype out as code other programs can link against
+ */
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define EXPORT_BENCH_CALLS 10000000 /* per side, in the generated bench */
+
+int export_all(const char *prefix, const char *module,
+               const genoscore *, const genx_iface *);
+
+#endif
+
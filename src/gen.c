@@ -16,6 +16,10 @@
 #include "rnd.h"
 #include "x86.h"
 #include "run.h"
+#include "mon.h"
+#include "prof.h"
+#include "adapt.h"
+#include "lex.h"
 
 extern const struct x86 X86[X86_COUNT];
 extern int Dump;
@@ -33,7 +37,7 @@ static void chromo_random(genotype *g, unsigned off, unsigned len)
 #ifdef X86_USE_FLOAT
 do_over:
 #endif
-    g->chromo[i].x86 = randr(X86_FIRST, X86_COUNT - 1);
+    g->chromo[i].x86 = x86_random();
     assert(g->chromo[i].x86 >= X86_FIRST);
     assert(g->chromo[i].x86 < X86_COUNT);
 #ifdef X86_USE_FLOAT
@@ -51,6 +55,8 @@ do_over:
 #endif
       x = X86 + g->chromo[i].x86;
       g->chromo[i].modrm = gen_modrm(x->modrm);
+      if (x->vex)
+        g->chromo[i].data[0] = rnd32() & 0x3; /* e[acdb]x, like gen_modrm */
       if (x->immlen) {
 #ifdef X86_USE_FLOAT
         if (FLT == x->flt)
@@ -67,13 +73,23 @@ do_over:
 
 #define MAX(a,b) ((a)>(b)?(a):(b))
 
-static void gen_mutate(genotype *g)
+/**
+ * remember the ops chromo_random() just drew, for credit assignment
+ */
+static void mut_note(genotype *g, u32 off, u32 len)
+{
+  while (len-- && g->mut.nop < GEN_MUT_OPS)
+    g->mut.op[g->mut.nop++] = g->chromo[off++].x86;
+}
+
+void gen_mutate(genotype *g)
 {
   u32 ooff,
       olen,
       rlen,
       suflen;
   s32 difflen;
+  enum mut_shape shape;
 
 /*
  * randomly mutate a genotype
@@ -111,6 +127,7 @@ static void gen_mutate(genotype *g)
  *                                               g->len
  */
 
+again:
   ooff = randr(GEN_PREFIX_LEN, g->len);
 #ifdef DEBUG
   assert(ooff >= GEN_PREFIX_LEN);
@@ -174,6 +191,14 @@ static void gen_mutate(genotype *g)
   rlen = randr(olen - ((olen > 0) && (g->len - olen > GEN_PREFIX_LEN)),
                olen + (g->len < GEN_PREFIX_LEN + Iface->opt.chromo_max));
 
+  /*
+   * the draw above gives each shape its "natural" frequency; adapt.c
+   * reweights shapes by thinning that with rejection
+   */
+  shape = mut_shape(olen, rlen);
+  if (!adapt_keep(shape))
+    goto again;
+
 #ifdef DEBUG
   assert(rlen <= Iface->opt.chromo_max);
   assert(rlen <= g->len + 1);
@@ -222,7 +247,10 @@ static void gen_mutate(genotype *g)
 
   if (rlen > 0) {
     chromo_random(g, ooff, rlen);
+    mut_note(g, ooff, rlen);
   }
+  if (shape != MUT_COUNT)
+    g->mut.shape |= 1 << shape;
 
 #ifdef DEBUG
   assert(difflen <= (s32)g->len);
@@ -252,24 +280,30 @@ static void gen_mutate(genotype *g)
 void gen_copy(genotype *dst, const genotype *src)
 {
   dst->len = src->len;
+  dst->mut = src->mut;
   memcpy(dst->chromo, src->chromo, src->len * sizeof src->chromo[0]);
 }
 
 void genoscore_copy(genoscore *dst, const genoscore *src)
 {
   dst->score = src->score;
+  dst->cyc = src->cyc;
+  dst->screen = src->screen;
   gen_copy(&dst->geno, &src->geno);
 }
 
 /**
- *
+ * produce a new genotype in dst; a mutated copy of src, or a fresh
+ * single-chromosome one if src is NULL
  */
-static void gen_gen(genotype *dst, const genotype *src, const double mutate_rate)
+void gen_gen(genotype *dst, const genotype *src, const double mutate_rate)
 {
   if (src) {
     /* mutate an existing genotype; by far the most common */
     gen_copy(dst, src);
     dst->len -= GEN_SUFFIX_LEN;
+    dst->mut.shape = 0;
+    dst->mut.nop = 0;
     do
       gen_mutate(dst);
     while (mutate_rate <= rand01());
@@ -284,6 +318,9 @@ static void gen_gen(genotype *dst, const genotype *src, const double mutate_rate
     dst->len = GEN_PREFIX_LEN + 1;
     GEN_PREFIX(dst);
     chromo_random(dst, GEN_PREFIX_LEN, 1);
+    dst->mut.shape = 0;
+    dst->mut.nop = 0;
+    mut_note(dst, GEN_PREFIX_LEN, 1);
   }
 
 #ifdef DEBUG
@@ -315,10 +352,15 @@ void pop_gen(struct pop *p, const u32 keep, const genx_iface *iface)
      * if a set if [0..keep-1] "best" are set, select a random one
      * to serve as the basis for each member of the new generation
      */
+    u32 parent[256];
     for (i = keep; i < iface->opt.pop_size; i++) {
-      const genotype *src = &p->indiv[randr(0, keep-1)].geno;
+      const genotype *src;
+      if (0 == (i - keep) % 256)
+        randr_fill(parent, 256, 0, keep-1);
+      src = &p->indiv[parent[(i - keep) % 256]].geno;
       gen_gen(&p->indiv[i].geno, src, iface->opt.mutate_rate);
       GENOSCORE_SCORE(p->indiv+i) = GENOSCORE_WORST;
+      p->indiv[i].cyc = GENOSCORE_NOCYC;
     }
   } else {
     /*
@@ -328,6 +370,7 @@ void pop_gen(struct pop *p, const u32 keep, const genx_iface *iface)
     for (i = 0; i < iface->opt.pop_size; i++) {
       gen_gen(&p->indiv[i].geno, NULL, iface->opt.mutate_rate);
       GENOSCORE_SCORE(p->indiv+i) = GENOSCORE_WORST;
+      p->indiv[i].cyc = GENOSCORE_NOCYC;
     }
   }
 }
@@ -335,6 +378,29 @@ void pop_gen(struct pop *p, const u32 keep, const genx_iface *iface)
 /*
  *
  */
+/**
+ * VEX byte 2 with the op's register in vvvv, stored inverted
+ */
+static inline u8 vex_vvvv(const struct x86 *x, const struct op *op)
+{
+  return (x->op[2] & 0x87) | ((~op->data[0] & 0xF) << 3);
+}
+
+/**
+ * at&t text of a single op, no newline
+ */
+void op_dump(const struct op *o, FILE *f)
+{
+  const struct x86 *x = X86 + o->x86;
+  fprintf(f, x->descr, *(u32 *)&o->data);
+  if (x->modrmlen) {
+    char modbuf[16];
+    fprintf(f, " %s", disp_modrm(o->modrm, x->modrm, modbuf, sizeof modbuf));
+  }
+  if (x->vex)
+    fprintf(f, ", %%%s", x86_reg(o->data[0]));
+}
+
 void gen_dump(const struct genotype *g, FILE *f)
 {
   char hex[24],
@@ -344,7 +410,8 @@ void gen_dump(const struct genotype *g, FILE *f)
     const struct x86 *x = X86 + g->chromo[i].x86;
     h = hex;
     for (j = 0; j < x->oplen; j++) {
-      sprintf(h, "%02" PRIx8 " ", x->op[j]);
+      sprintf(h, "%02" PRIx8 " ",
+        x->vex && 2 == j ? vex_vvvv(x, g->chromo + i) : x->op[j]);
       h += 3;
     }
     if (x->modrmlen) {
@@ -358,12 +425,7 @@ void gen_dump(const struct genotype *g, FILE *f)
     memset(h, ' ', sizeof hex - (h - hex));
     hex[(sizeof hex) - 1] = '\0';
     fprintf(f, "%3" PRIu32 " %s", i, hex);
-    fprintf(f, x->descr, *(u32 *)&g->chromo[i].data);
-    if (x->modrmlen) {
-      char modbuf[16];
-      fprintf(f, " %s",
-        disp_modrm(g->chromo[i].modrm, x->modrm, modbuf, sizeof modbuf));
-    }
+    op_dump(g->chromo + i, f);
     fputc('\n', f);
   }
 }
@@ -386,6 +448,8 @@ inline static u32 chromo_add(const struct op *op, u8 *buf, u32 len)
    * we simply overwrite and extraneous bytes
    */
   memcpy(buf + len, x->op, sizeof x->op); 
+  if (x->vex)
+    buf[len + 2] = vex_vvvv(x, op);
   len += x->oplen;
   if (x->modrmlen)
     buf[len++] = op->modrm;
@@ -399,7 +463,7 @@ inline static u32 chromo_add(const struct op *op, u8 *buf, u32 len)
 /**
  * calculate the total size of the chromosome in bytes
  */
-static u32 chromo_bytes(const struct op *op)
+u32 chromo_bytes(const struct op *op)
 {
   const struct x86 *x = X86 + op->x86;
   u32 len = 0;
@@ -463,7 +527,8 @@ u32 gen_compile(genotype *g, u8 *buf, size_t buflen)
 }
 
 /**
- * shorter is better, given same score
+ * shorter is better, given same score; faster before shorter if
+ * --speed measured them
  */
 int genoscore_lencmp(const void *va, const void *vb)
 {
@@ -471,15 +536,18 @@ int genoscore_lencmp(const void *va, const void *vb)
                            *b = vb;
   register int cmp = (GENOSCORE_SCORE(a) > GENOSCORE_SCORE(b))
                    - (GENOSCORE_SCORE(a) < GENOSCORE_SCORE(b));
+  if (0 == cmp)
+    cmp = (a->cyc > b->cyc) - (a->cyc < b->cyc);
   if (0 == cmp)
     cmp = (a->geno.len > b->geno.len) - (a->geno.len < b->geno.len);
   return cmp;
 }
 
 /**
- * shorter is better, given same score
+ * shorter is better, given same score; faster before shorter if
+ * --speed measured them
  */
-static int score_id_lencmp(const void *va, const void *vb)
+int score_id_lencmp(const void *va, const void *vb)
 {
   register const struct score_id *a = va,
                                  *b = vb;
@@ -487,6 +555,10 @@ static int score_id_lencmp(const void *va, const void *vb)
     return 1;
   else if (GENOSCORE_SCORE(a) < GENOSCORE_SCORE(b))
     return -1;
+  else if (a->cyc > b->cyc)
+    return 1;
+  else if (a->cyc < b->cyc)
+    return -1;
   else if (a->len > b->len)
     return 1;
   else if (a->len < b->len)
@@ -504,8 +576,14 @@ inline static void genoscore_swap(genoscore *a, genoscore *b, genoscore *tmp)
 void pop_score(struct pop *p, const genx_iface *iface, genoscore *tmp)
 {
   u32 w = 0;
+  u64 t0 = prof_tsc(),
+      t1;
+  batch_next(iface);
   for (u32 i = 0; i < iface->opt.pop_size; i++) {
-    score(p->indiv + i, iface, 0);
+    if (Lex_Len)
+      score_cases(p->indiv + i, iface, lex_row(i));
+    else
+      score(p->indiv + i, iface, 0);
     if (GENOSCORE_NOT_WORST(p->indiv+i) || i < iface->opt.pop_keep) {
       /*
        * only count scores that are better than worst; since
@@ -515,18 +593,36 @@ void pop_score(struct pop *p, const genx_iface *iface, genoscore *tmp)
        * of unique entries
        */
       p->scores[w].score = p->indiv[i].score;
+      p->scores[w].cyc = p->indiv[i].cyc;
       p->scores[w].len = p->indiv[i].geno.len;
       p->scores[w].id = i;
       w++;
     }
   }
+  t1 = prof_tsc();
   qsort(p->scores, w, sizeof *p->scores, score_id_lencmp);
+  prof_span(PROF_SORT, "qsort", t1, prof_tsc());
+  batch_rescore(p, w, iface);
+  if (Speed)
+    speed_rank(p, w, iface);
+  if (Adapt)
+    adapt_credit(p, w, iface);
+  Mon[0].evals += iface->opt.pop_size;
+  /* count distinct scores; the list is sorted so duplicates are adjacent */
+  Mon[0].diversity = w > 0;
+  for (u32 i = 1; i < w; i++)
+    Mon[0].diversity += GENOSCORE_SCORE(p->scores + i) != GENOSCORE_SCORE(p->scores + i - 1);
+  lex_select(p, w, iface);
   /* copy the best pop_keep items to the front */
   for (u32 i = 0; i < iface->opt.pop_keep; i++) {
+    lex_moved(i, p->scores[i].id);
     genoscore_swap(p->indiv + i,
                    p->indiv + p->scores[i].id,
                    tmp);
   }
+  lex_place(p, iface, tmp);
+  screen_update(p, iface);
+  prof_span(PROF_COUNT, "pop_score", t0, prof_tsc());
 }
 
 #if 0
@@ -594,12 +690,13 @@ void genx_iface_dump(const genx_iface *iface)
   printf("   .done........%p\n",  (void *)iface->test.i.done);
   printf("   .data\n");
   printf("     .len.......%lu\n", (unsigned long)iface->test.i.data.len);
-  printf("     [0]: .in { %lu, %lu, %lu, %lu } .out { %lu }\n",
-                                  (unsigned long)iface->test.i.data.list[0].in[0],
-                                  (unsigned long)iface->test.i.data.list[0].in[1],
-                                  (unsigned long)iface->test.i.data.list[0].in[2],
-                                  (unsigned long)iface->test.i.data.list[0].in[3],
-                                  (unsigned long)iface->test.i.data.list[0].out);
+  if (iface->test.i.data.len)
+    printf("     [0]: .in { %lu, %lu, %lu, %lu } .out { %lu }\n",
+                                    (unsigned long)iface->test.i.data.list[0].in[0],
+                                    (unsigned long)iface->test.i.data.list[0].in[1],
+                                    (unsigned long)iface->test.i.data.list[0].in[2],
+                                    (unsigned long)iface->test.i.data.list[0].in[3],
+                                    (unsigned long)iface->test.i.data.list[0].out);
   printf(" .opt:\n");
   printf("  .param_cnt....%lu\n", (unsigned long)iface->opt.param_cnt);
   printf("  .chromo_min...%lu\n", (unsigned long)iface->opt.chromo_min);
@@ -614,5 +711,12 @@ void genx_iface_dump(const genx_iface *iface)
   printf("  .algebra_ops..%d\n", iface->opt.x86.algebra_ops);
   printf("  .bit_ops......%d\n", iface->opt.x86.bit_ops);
   printf("  .random_const.%d\n", iface->opt.x86.random_const);
+  printf(" .v2:\n");
+  printf("  .abi..........%lu\n", (unsigned long)iface->v2.abi);
+  printf("  .rows.........%lu\n", (unsigned long)iface->v2.rows);
+  printf("  .weight.......%p\n", (void *)iface->v2.weight);
+  printf("  .op_weight:\n");
+  for (const struct x86_weight *w = iface->v2.op_weight; w && w->name; w++)
+    printf("  %-12s.%lu\n", w->name, (unsigned long)w->weight);
 }
 
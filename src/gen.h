@@ -66,6 +66,22 @@
   } while (0)
 #endif
 
+/*
+ * shape of a gen_mutate() edit, by how the replacement length
+ * compares to the replaced one; replacements are bucketed by length
+ */
+enum mut_shape {
+  MUT_INSERT,   /* rlen > olen */
+  MUT_DELETE,   /* rlen < olen */
+  MUT_REPLACE1, /* rlen == olen == 1 */
+  MUT_REPLACE2,
+  MUT_REPLACE4, /* 3..4 */
+  MUT_REPLACEN, /* 5+ */
+  MUT_COUNT     /* last, special; also "no-op" */
+};
+
+#define GEN_MUT_OPS 6
+
 struct genotype {
   u32 len;
   struct op {
@@ -73,10 +89,17 @@ struct genotype {
        modrm,   /* mod/rm byte, if used */
        data[4]; /* random integer data, if used */
   } *chromo;
+  struct gen_mut {  /* what produced this genotype; see adapt.c */
+    u8 shape,       /* bitmask of 1 << enum mut_shape */
+       nop,
+       op[GEN_MUT_OPS]; /* X86[] indices newly drawn */
+  } mut;
 };
 typedef struct genotype genotype;
 
 void gen_copy(genotype *dst, const genotype *src);
+void gen_mutate(genotype *);
+void gen_gen(genotype *dst, const genotype *src, const double mutate_rate);
 
 struct pop {
   u32 len;
@@ -85,11 +108,14 @@ struct pop {
       float f;
       u32   i;
     } score;
-    u32 len,
+    u32 cyc,
+        len,
         id;
   } *scores;
   struct genoscore {
     union sc score;
+    u32 cyc,   /* --speed: measured cycles/call x16, else GENOSCORE_NOCYC */
+        screen; /* score on the screen rows, if any; see run.c */
     struct genotype geno;
   } *indiv;
 };
@@ -97,9 +123,12 @@ typedef struct genoscore genoscore;
 
 void genoscore_copy(genoscore *dst, const genoscore *src);
 void gen_dump(const genotype *, FILE *);
+void op_dump(const struct op *, FILE *);
 u32  gen_compile(genotype *, u8 *, size_t);
+u32  chromo_bytes(const struct op *);
 
 int genoscore_lencmp(const void *, const void *);
+int score_id_lencmp(const void *, const void *);
 
 #ifdef X86_USE_FLOAT
 # define GENOSCORE_SCORE(gs)  ((gs)->score.f)
@@ -111,6 +140,8 @@ int genoscore_lencmp(const void *, const void *);
 # define GENOSCORE_BEST       0
 #endif
 
+#define GENOSCORE_NOCYC         0xFFFFFFFFU /* not measured */
+
 #define GENOSCORE_MATCH(gs)     (GENOSCORE_SCORE(gs) <= GENOSCORE_BEST)
 /*
  * better than the worst-possible score
@@ -121,7 +152,9 @@ int genoscore_lencmp(const void *, const void *);
 
 enum scoretype {
   SCORE_BIT,
-  SCORE_ALG
+  SCORE_ALG,
+  SCORE_HASH, /* no table: hash v2.hash's keys; see hash.h */
+  SCORE_MPH   /* data rows are keys, outputs slots; score is collisions */
 };
 
 struct genx_iface {
@@ -133,8 +166,8 @@ struct genx_iface {
 	    u32 (*func)(const u32 []);
 	    int (*done)(const genoscore *);
 	    struct {
-		    const unsigned len;
-        const struct {
+		    unsigned len;
+        const struct genx_test {
           u32   in[4],
                 out;
         } *list;
@@ -162,9 +195,66 @@ struct genx_iface {
               random_const:1;
 	  } x86;       
   } opt;
+  /*
+   * ABI v2: modules that export load2() instead of load() fill this
+   * in; genx zeroes it for the rest, whose struct ends with opt, and
+   * keeps what it derives itself here too. a v2 module may leave data
+   * empty and have genx build rows tests from its callbacks, again
+   * every refresh generations.
+   */
+  struct genx_v2 {
+    u32 abi,     /* GENX_ABI */
+        rows,
+        refresh; /* 0: never */
+    /* inputs to draw from and --verify sweeps, per param; those past domains span all of u32 */
+    u32 domains;
+    struct {
+      u32 lo,
+          hi;
+    } domain[3];
+    /* optional: fill in[0..2][0..n); else uniform over domain[] */
+    void (*inputs)(u32 *const in[3], u32 n, u32 seed);
+    /* optional: out[i] = func(in[0][i], in[1][i], in[2][i]), all at once */
+    void (*ref)(const u32 *const in[3], u32 *out, u32 n);
+    /* optional: row i's distance counts weight[i] times; NULL is 1 */
+    const u32 *weight;
+    /*
+     * optional: a few rows most wrong candidates already fail, run
+     * before data; with len 0 genx spreads its own over data
+     */
+    struct {
+      unsigned len;
+      const struct genx_test *list;
+    } screen;
+    /* optional: a CSV or GENXDAT1 file whose rows replace data; --data */
+    const char *path;
+    /* SCORE_HASH: the keys, and what a cycle per 16 bytes costs */
+    struct {
+      unsigned len;
+      const struct genx_key {
+        const u8 *p;
+        u32       len;
+      } *list;
+      u32 speed;
+    } hash;
+    /* SCORE_MPH: table size; 0 is one slot per key, a minimal hash */
+    struct {
+      u32 slots;
+    } mph;
+    /*
+     * optional per-mnemonic sampling weights, terminated by a NULL
+     * name; X86_WEIGHT_DEFAULT is what unlisted ops get, 0 disables
+     */
+    const struct x86_weight {
+      const char *name;
+      u32         weight;
+    } *op_weight;
+  } v2;
 };
 typedef struct genx_iface genx_iface;
 
+#define GENX_ABI 2
+
 void pop_score(struct pop *, const genx_iface *, genoscore *tmp);
 void pop_gen(struct pop *, u32 keep, const genx_iface *);
              
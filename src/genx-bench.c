@@ -0,0 +1,254 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * micro-benchmarks for the hot kernels; fixed seed, fixed population,
+ * fixed test table so runs are comparable between builds.
+ *
+ * results are one tab-separated line per kernel:
+ *
+ *   bench <kernel> <backend> <ops> <ns/op> <genotypes/sec>
+ *
+ * genotypes/sec is 0 for kernels that don't handle whole genotypes
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef linux
+# include <sys/mman.h>
+#endif
+#include "typ.h"
+#include "rnd.h"
+#include "x86.h"
+#include "gen.h"
+#include "run.h"
+#include "adapt.h"
+#include "dist.h"
+#include "eff.h"
+#include "canon.h"
+#include "split.h"
+
+#define BENCH_SEED    0x1234567
+#define BENCH_POP     4096
+#define BENCH_TESTS   32
+#define BENCH_REPEAT  5   /* best of */
+#define BENCH_BACKEND "native"
+#define BENCH_DIST    4096 /* tests per dist.* op */
+#define BENCH_DIST_REPS 20000
+
+int Dump = 0;
+struct genx_iface *Iface = NULL;
+
+static struct {
+  u32 in[4],
+      out;
+} Test[BENCH_TESTS];
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
+static struct genx_iface Bench_Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = NULL,
+    .func = NULL,
+    .done = done,
+    .data = {
+      .len  = BENCH_TESTS,
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 16,
+    .pop_size       = BENCH_POP,
+    .pop_keep       = 4,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+static struct pop Pop;
+static genoscore  Tmp;
+static u8        *Buf;
+#define BUFLEN 4096
+
+static double now_ns(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static const char *Backend = BENCH_BACKEND;
+
+static void report(const char *kernel, u64 ops, double ns, u32 genos_per_op)
+{
+  double nsop = ns / ops;
+  printf("bench\t%s\t%s\t%" PRIu64 "\t%.2f\t%.0f\n",
+    kernel, Backend, ops, nsop,
+    genos_per_op ? 1e9 / nsop * genos_per_op : 0.);
+}
+
+/*
+ * each kernel runs 'ops' times per repeat; we keep the fastest
+ * repeat, the others are mostly other processes' noise
+ */
+#define BENCH(kernel, ops, genos, setup, body) do {   \
+    double best = 1e300;                              \
+    u64 n_;                                           \
+    int r_;                                           \
+    for (r_ = 0; r_ < BENCH_REPEAT; r_++) {           \
+      double t_;                                      \
+      rnd32_init(BENCH_SEED);                         \
+      setup;                                          \
+      t_ = now_ns();                                  \
+      for (n_ = 0; n_ < (ops); n_++) {                \
+        body;                                         \
+      }                                               \
+      t_ = now_ns() - t_;                             \
+      if (t_ < best)                                  \
+        best = t_;                                    \
+    }                                                 \
+    report(kernel, ops, best, genos);                 \
+  } while (0)
+
+static void pop_alloc(struct pop *p, const genx_iface *iface)
+{
+  u32 i;
+  p->len = iface->opt.pop_size;
+  p->indiv = malloc(p->len * sizeof p->indiv[0]);
+  p->scores = malloc(p->len * sizeof p->scores[0]);
+  p->indiv[0].geno.chromo = malloc(p->len * CHROMO_SIZE(iface) * sizeof(struct op));
+  assert(p->indiv && p->scores && p->indiv[0].geno.chromo);
+  for (i = 1; i < p->len; i++)
+    p->indiv[i].geno.chromo = p->indiv[i-1].geno.chromo + CHROMO_SIZE(iface);
+  for (i = 0; i < p->len; i++)
+    p->indiv[i].geno.len = 0;
+}
+
+/**
+ * a population a few generations in: varied lengths, like a real run
+ */
+static void pop_fixed(void)
+{
+  int i;
+  rnd32_init(BENCH_SEED);
+  pop_gen(&Pop, 0, Iface);
+  for (i = 0; i < 8; i++)
+    pop_gen(&Pop, Iface->opt.pop_keep, Iface);
+}
+
+int main(void)
+{
+  static volatile u32 sink;
+  genotype g;
+  u32 i;
+
+  for (i = 0; i < BENCH_TESTS; i++) {
+    Test[i].in[0] = i * i * 977 + i;
+    Test[i].out = i * 31;
+  }
+  Iface = &Bench_Iface;
+  x86_init(Iface);
+  Adapt = 0; /* keep the mutation mix fixed across repetitions */
+  Cache = 0; /* repetitions would only measure cache hits */
+  Batch = 0;
+  Split = 0;
+  run_init(Iface);
+#ifdef linux
+  Buf = mmap(0, BUFLEN, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+  assert(MAP_FAILED != Buf);
+#else
+  Buf = malloc(BUFLEN);
+#endif
+  pop_alloc(&Pop, Iface);
+  Tmp.geno.chromo = malloc(CHROMO_SIZE(Iface) * sizeof(struct op));
+  g.chromo = malloc(CHROMO_SIZE(Iface) * sizeof(struct op));
+  pop_fixed();
+
+  printf("#bench\tkernel\tbackend\tops\tns/op\tgenotypes/sec\n");
+
+  BENCH("rnd32", 10000000, 0, (void)0, sink += rnd32());
+  BENCH("randr", 10000000, 0, (void)0, sink += randr(3, 1000));
+  BENCH("popcnt", 10000000, 0, (void)0, sink += popcnt((u32)n_ * 0x9E3779B9u));
+
+  BENCH("gen_mutate", 1000000, 0,
+    (gen_copy(&g, &Pop.indiv[0].geno), g.len -= GEN_SUFFIX_LEN),
+    gen_mutate(&g));
+  BENCH("gen_gen", 1000000, 1, (void)0,
+    gen_gen(&g, &Pop.indiv[n_ % Pop.len].geno, Iface->opt.mutate_rate));
+
+  BENCH("gen_compile", 1000000, 1, (void)0,
+    sink += gen_compile(&Pop.indiv[n_ % Pop.len].geno, Buf, BUFLEN));
+
+  BENCH("eff_const", 1000000, 1, (void)0,
+    sink += eff_const(&Pop.indiv[n_ % Pop.len].geno));
+
+  BENCH("canon_hash", 1000000, 1, (void)0,
+    sink += (u32)canon_hash(&Pop.indiv[n_ % Pop.len].geno));
+
+  gen_compile(&Pop.indiv[0].geno, Buf, BUFLEN);
+  BENCH("shim_i", 10000000, 0, (void)0,
+    sink += shim_i(Buf, (u32)n_, 0, 0));
+
+  Bench_Iface.test.i.score = SCORE_ALG;
+  run_select(Iface);
+  BENCH("score.alg", 200000, 1, (void)0,
+    score(&Pop.indiv[n_ % Pop.len], Iface, 0));
+  Const = CONST_OFF;
+  BENCH("score.alg.all", 200000, 1, (void)0,
+    score(&Pop.indiv[n_ % Pop.len], Iface, 0));
+  Const = CONST_ONCE;
+  Bench_Iface.test.i.score = SCORE_BIT;
+  run_select(Iface);
+  BENCH("score.bit", 200000, 1, (void)0,
+    score(&Pop.indiv[n_ % Pop.len], Iface, 0));
+  Bench_Iface.test.i.score = SCORE_ALG;
+  run_select(Iface);
+
+  BENCH("pop_score", 20, BENCH_POP, pop_fixed(),
+    pop_score(&Pop, Iface, &Tmp));
+
+  /* whole-table distance per backend this cpu runs; an op is BENCH_DIST tests */
+  {
+    static u32 got[BENCH_DIST], want[BENCH_DIST];
+    const struct dist *d;
+    for (i = 0; i < BENCH_DIST; i++) {
+      got[i] = rnd32();
+      want[i] = rnd32();
+    }
+    for (d = Dist; d->name; d++) {
+      if (!d->ok())
+        continue;
+      Backend = d->name;
+      BENCH("dist.bit", BENCH_DIST_REPS, 0, (void)0,
+        sink += (u32)d->bit(got, want, BENCH_DIST));
+      BENCH("dist.alg", BENCH_DIST_REPS, 0, (void)0,
+        sink += (u32)d->alg(got, want, BENCH_DIST));
+    }
+    Backend = BENCH_BACKEND;
+  }
+
+  return 0;
+}
+
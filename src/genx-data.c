@@ -0,0 +1,31 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * convert a CSV test set into the GENXDAT1 columns genx maps
+ *
+ *   genx-data in.csv out.dat
+ *   genx --data=out.dat problems/dataset.so
+ *
+ * see data.c for the CSV layout
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "typ.h"
+#include "data.h"
+
+int main(int argc, char *argv[])
+{
+  if (3 != argc) {
+    fprintf(stderr, "Usage: %s in.csv out.dat\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return data_csv2bin(argv[1], argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
@@ -0,0 +1,115 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * attach to a running genx's metrics page and display live rates
+ *
+ *   genx-top <pid>
+ *
+ * send the run SIGUSR1 (kill -USR1 <pid>) to have it dump its
+ * current best genotype. exits once the run does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "typ.h"
+#include "mon.h"
+
+/**
+ * take a consistent copy of the page; see the seqlock note in mon.h
+ */
+static void snapshot(const struct mon_page *m, struct mon_page *s)
+{
+  u32 seq;
+  do {
+    while ((seq = m->seq) & 1)
+      ;
+    __sync_synchronize();
+    memcpy(s, (const void *)m, sizeof *s);
+    __sync_synchronize();
+  } while (seq != m->seq);
+}
+
+static double pct(u64 n, u64 d)
+{
+  return d ? 100. * (double)n / (double)d : 0.;
+}
+
+int main(int argc, char *argv[])
+{
+  char name[32];
+  int fd;
+  const struct mon_page *m;
+  struct mon_page cur, prev;
+  u32 i;
+
+  if (argc < 2) {
+    printf("Usage: genx-top pid\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(name, sizeof name, MON_SHM_FMT, strtoul(argv[1], NULL, 10));
+  fd = shm_open(name, O_RDONLY, 0);
+  if (-1 == fd) {
+    perror(name);
+    exit(EXIT_FAILURE);
+  }
+  m = mmap(0, sizeof *m, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (MAP_FAILED == m) {
+    perror("mmap");
+    exit(EXIT_FAILURE);
+  }
+  if (MON_MAGIC != m->magic || MON_VERSION != m->version) {
+    fprintf(stderr, "%s: not a genx metrics page (version %" PRIu32 ")\n",
+      name, m->version);
+    exit(EXIT_FAILURE);
+  }
+
+  snapshot(m, &prev);
+  for (;;) {
+    u64 evals = 0, distinct = 0, early = 0, look = 0, hit = 0, cnst = 0;
+    sleep(1);
+    if (-1 == kill((pid_t)m->pid, 0) && ESRCH == errno) {
+      printf("genx-top: %" PRIu32 " has exited\n", m->pid);
+      break;
+    }
+    snapshot(m, &cur);
+    for (i = 0; i < cur.threads; i++) {
+      const struct mon_stat *c = cur.thread + i,
+                            *p = prev.thread + i;
+      evals    += c->evals - p->evals;
+      early    += c->early_exit - p->early_exit;
+      look     += c->cache_lookup - p->cache_lookup;
+      hit      += c->cache_hit - p->cache_hit;
+      cnst     += c->constant - p->constant;
+      distinct += c->diversity;
+    }
+    printf("gen %7" PRIu64 " best %10" PRIu64 " len %3" PRIu32
+           " %9.1fk/sec early %5.1f%% const %5.1f%% cache %5.1f%%"
+           " div %6" PRIu64 " up %" PRIu64 "s\n",
+      cur.gen, cur.best_score, cur.best_len, evals / 1000.,
+      pct(early, evals), pct(cnst, evals), pct(hit, look), distinct,
+      cur.now - cur.start);
+    if (cur.threads > 1) {
+      for (i = 0; i < cur.threads; i++)
+        printf("  #%-2" PRIu32 " %9.1fk/sec %9.1fM rows/sec\n", i,
+          (cur.thread[i].evals - prev.thread[i].evals) / 1000.,
+          (cur.thread[i].rows - prev.thread[i].rows) / 1e6);
+    }
+    fflush(stdout);
+    prev = cur;
+  }
+  return 0;
+}
+
@@ -0,0 +1,153 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * time-to-solution runner: run genx on each module many times with
+ * consecutive seeds under a time budget and report the distribution
+ *
+ *   genx-tts [-n runs] [-b budget_sec] [-s first_seed] [-x genx] module...
+ *
+ * one tab-separated line per module:
+ *
+ *   tts <module> <runs> <solved> <success%> <median sec> <p90 sec>
+ *
+ * unsolved runs count as infinitely slow, so a percentile that lands
+ * on one is printed as "-"
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "typ.h"
+
+#define UNSOLVED 1e300
+
+static double now_sec(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * @return seconds to solution, or UNSOLVED
+ */
+static double run_once(const char *genx, const char *module, u32 seed, unsigned budget)
+{
+  char seedbuf[16], budgetbuf[16];
+  double t = now_sec();
+  int status;
+  pid_t pid;
+  snprintf(seedbuf, sizeof seedbuf, "%" PRIu32, seed);
+  snprintf(budgetbuf, sizeof budgetbuf, "%u", budget);
+  pid = fork();
+  if (-1 == pid) {
+    perror("fork");
+    exit(EXIT_FAILURE);
+  } else if (0 == pid) {
+    int null = open("/dev/null", O_WRONLY);
+    dup2(null, STDOUT_FILENO);
+    dup2(null, STDERR_FILENO);
+    execl(genx, genx, "-s", seedbuf, "-b", budgetbuf, module, (char *)NULL);
+    _exit(127);
+  }
+  if (-1 == waitpid(pid, &status, 0)) {
+    perror("waitpid");
+    exit(EXIT_FAILURE);
+  }
+  t = now_sec() - t;
+  if (WIFEXITED(status) && 127 == WEXITSTATUS(status)) {
+    fprintf(stderr, "could not run %s\n", genx);
+    exit(EXIT_FAILURE);
+  }
+  return WIFEXITED(status) && 0 == WEXITSTATUS(status) ? t : UNSOLVED;
+}
+
+static int dblcmp(const void *va, const void *vb)
+{
+  const double *a = va,
+               *b = vb;
+  return (*a > *b) - (*a < *b);
+}
+
+/**
+ * nearest-rank percentile of sorted t[0..n)
+ */
+static double percentile(const double *t, unsigned n, unsigned pct)
+{
+  unsigned rank = (pct * n + 99) / 100;
+  return t[rank ? rank - 1 : 0];
+}
+
+static void print_sec(double t)
+{
+  if (t >= UNSOLVED)
+    printf("\t-");
+  else
+    printf("\t%.2f", t);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *genx = "./genx";
+  unsigned runs = 20,
+           budget = 60,
+           solved,
+           r;
+  u32 seed = 1;
+  double *t;
+  int opt;
+
+  while (-1 != (opt = getopt(argc, argv, "n:b:s:x:"))) {
+    switch (opt) {
+    case 'n': runs   = (unsigned)strtoul(optarg, NULL, 0); break;
+    case 'b': budget = (unsigned)strtoul(optarg, NULL, 0); break;
+    case 's': seed   = (u32)strtoul(optarg, NULL, 0); break;
+    case 'x': genx   = optarg; break;
+    default:  optind = argc + 1; break;
+    }
+  }
+  if (optind >= argc || 0 == runs || 0 == budget) {
+    printf("Usage: genx-tts [-n runs] [-b budget_sec] [-s first_seed]"
+           " [-x path/to/genx] module...\n");
+    exit(EXIT_FAILURE);
+  }
+  t = malloc(runs * sizeof *t);
+  if (NULL == t) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+
+  printf("#tts\tmodule\truns\tsolved\tsuccess%%\tmedian\tp90\n");
+  for (; optind < argc; optind++) {
+    const char *module = argv[optind];
+    solved = 0;
+    for (r = 0; r < runs; r++) {
+      t[r] = run_once(genx, module, seed + r, budget);
+      solved += t[r] < UNSOLVED;
+      fprintf(stderr, "%s seed %" PRIu32 ": ", module, seed + r);
+      if (t[r] < UNSOLVED)
+        fprintf(stderr, "%.2fs\n", t[r]);
+      else
+        fprintf(stderr, "unsolved\n");
+    }
+    qsort(t, runs, sizeof *t, dblcmp);
+    printf("tts\t%s\t%u\t%u\t%.1f", module, runs, solved, 100. * solved / runs);
+    print_sec(percentile(t, runs, 50));
+    print_sec(percentile(t, runs, 90));
+    putchar('\n');
+    fflush(stdout);
+  }
+  free(t);
+  return 0;
+}
+
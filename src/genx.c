@@ -19,17 +19,34 @@
 #include <dlfcn.h> /* dlopen */
 #define _XOPEN_SOURCE 500
 #include <stdlib.h>
+#include <stddef.h> /* offsetof */
 #include "typ.h"
 #include "rnd.h"
 #include "x86.h"
 #include "gen.h"
 #include "run.h"
+#include "mon.h"
+#include "prof.h"
+#include "pmc.h"
+#include "adapt.h"
+#include "lex.h"
+#include "export.h"
+#include "verify.h"
+#include "enumerate.h"
+#include "data.h"
+#include "split.h"
+#include "hash.h"
 
 int Dump = 0; /* verbosity level */
 
 static void *Iface_Handle = NULL;
 struct genx_iface *Iface = NULL;
+static struct genx_iface Live; /* our copy of the module's; the tests may grow */
 
+/**
+ * load2() if the module has it, else load(); a v1 module's struct
+ * ends where v2 begins
+ */
 static struct genx_iface * load_module(const char *path)
 {
   errno = 0;
@@ -38,13 +55,25 @@ static struct genx_iface * load_module(const char *path)
     fprintf(stderr, dlerror());
     fputc('\n', stderr);
   } else {
-    void *sym = dlsym(Iface_Handle, "load");
+    void *sym = dlsym(Iface_Handle, "load2");
+    int abi = 2;
+    if (NULL == sym) {
+      sym = dlsym(Iface_Handle, "load");
+      abi = 1;
+    }
     if (NULL == sym) {
       fprintf(stderr, dlerror());
       fputc('\n', stderr);
       dlclose(Iface_Handle);
     } else {
       Iface = ((struct genx_iface *(*)())sym)(); /* fucking ISO C... */
+      memset(&Live, 0, sizeof Live);
+      memcpy(&Live, Iface, 1 == abi ? offsetof(struct genx_iface, v2) : sizeof Live);
+      if (2 == abi && GENX_ABI != Live.v2.abi) {
+        fprintf(stderr, "%s: ABI %" PRIu32 ", genx speaks %d\n", path, Live.v2.abi, GENX_ABI);
+        dlclose(Iface_Handle);
+        Iface = NULL;
+      }
     }
   }
   return Iface;
@@ -118,24 +147,62 @@ static void commafy(char *dst, size_t dstlen, const char *fmt, const u64 n)
   dst[off - (off > 0)] = '\0';
 }
 
+/* generations across every evolve() call; a resume mustn't redraw old tables */
+static u32 Refresh_Gen = 0;
+
 /**
- * 
+ * run generations until the module is satisfied or, if 'budget' is
+ * non-zero, that many seconds have passed. 'resume' carries on with
+ * pop as the last call left it.
+ * @return non-zero if the module's done() was satisfied
  */
-static void evolve(
+/**
+ * is a better than best? timing the same code again comes out a tick
+ * or two apart, so with --speed a gain in cycles alone has to clear
+ * RUN_SPEED_MARGIN; under that the two count as equally fast
+ */
+static int better(const genoscore *a, const genoscore *best)
+{
+  if (Speed && GENOSCORE_SCORE(a) == GENOSCORE_SCORE(best)
+   && a->cyc < best->cyc && GENOSCORE_NOCYC != best->cyc) {
+    const u32 gain = best->cyc - a->cyc;
+    if (gain < 16 || (u64)gain * 100 < (u64)best->cyc * RUN_SPEED_MARGIN)
+      return a->geno.len < best->geno.len;
+  }
+  return -1 == genoscore_lencmp(a, best);
+}
+
+static int evolve(
         genoscore  *best,
         genoscore  *tmp,
         struct pop *pop,
-  const genx_iface *iface,
-  const time_t      start)
+        genx_iface *iface,
+  const time_t      start,
+  const time_t      budget,
+  const int         resume)
 {
-  u32 gencnt = 0;
+  u32 gencnt = 0,
+      stale = 0, /* generations without progress */
+      patience = Speed ? RUN_SPEED_PATIENCE : 0;
+  int solved;
   GENOSCORE_SCORE(best) = GENOSCORE_WORST;
+  best->cyc = GENOSCORE_NOCYC;
   best->geno.len = 0;
-  pop_gen(pop, 0, iface);
+  u64 t0 = prof_tsc();
+  if (!resume) /* else pop holds the next generation already */
+    pop_gen(pop, 0, iface);
+  prof_span(PROF_GEN, "pop_gen", t0, prof_tsc());
   do {
     int progress;
+    if (data_refresh(iface, Refresh_Gen++)) {
+      /* new rows: best's score was on the old ones; pop_score() redoes the rest */
+      run_select(iface);
+      if (best->geno.len)
+        score(best, iface, 0);
+    }
     pop_score(pop, iface, tmp);
-    progress = -1 == genoscore_lencmp(pop->indiv, best);
+    progress = better(pop->indiv, best);
+    stale = progress ? 0 : stale + 1;
     if (progress || 0 == gencnt % 1000) { /* display generation regularly or on progress */
       char indivbuf[32];
       u64 indivs = (u64)iface->opt.pop_size * (u64)(gencnt + 1);
@@ -144,17 +211,38 @@ static void evolve(
       commafy(indivbuf, sizeof indivbuf, "%llu", indivs);
       printf("GEN %7" PRIu32 " %15s genotypes (%.1fk/sec) @%s",
         gencnt, indivbuf, rate, ctime(&t));
+      prof_report(stdout);
+      pmc_report(stdout);
+      if (Dump)
+        adapt_report(stdout);
       if (progress) {
         genoscore_copy(best, &pop->indiv[0]);
         gen_dump(&best->geno, stdout);
         printf("->score=%" PRIt "\n", GENOSCORE_SCORE(pop->indiv));
         score(best, iface, 1);
+        if (Speed && best->cyc != GENOSCORE_NOCYC)
+          printf("->cycles=%.2f\n", best->cyc / 16.);
       }
     }
-    pop_gen(pop, iface->opt.pop_keep, iface);
+    if (mon_dump_requested()) {
+      printf("SIGUSR1 GEN %" PRIu32 " best:\n", gencnt);
+      gen_dump(&best->geno, stdout);
+      score(best, iface, 1);
+      adapt_report(stdout);
+      fflush(stdout);
+    }
+    mon_publish(gencnt, GENOSCORE_SCORE(best), best->geno.len);
+    prof_gen_end(gencnt);
+    if (Pmc)
+      pmc_gen_mark();
+    t0 = prof_tsc();
+    pop_gen(pop, iface->opt.pop_keep + Lex_Kept, iface);
+    prof_span(PROF_GEN, "pop_gen", t0, prof_tsc());
     gencnt++;
-  } while (!(*iface->test.i.done)(best)
-  );
+    /* --speed keeps going after a match, until it stops getting faster */
+  } while (!((solved = (*iface->test.i.done)(best)) && stale >= patience)
+        && !(budget && time(NULL) - start >= budget));
+  return solved;
 }
 
 int main(int argc, char *argv[])
@@ -164,9 +252,92 @@ int main(int argc, char *argv[])
              Tmp;   /* swap space for sorting/swapping */
   time_t     Start;
   int        mod_idx = 1; /* argv[mod_idx] is name of module */
+  const char *trace = NULL,
+             *export = NULL,
+             *adapt_in = NULL,
+             *adapt_out = NULL,
+             *data = NULL;
+  unsigned   trace_first = 0,
+             trace_count = 100;
+  int        perf_counters = 0,
+             evolved = 0, /* Pop holds a generation */
+             solved;
+  u32        seed = (u32)time(NULL);
+  unsigned long budget = 0;
+
+  for (; mod_idx < argc && '-' == argv[mod_idx][0]; mod_idx++) {
+    const char *a = argv[mod_idx];
+    if (0 == strcmp("-d", a)) {
+      Dump = 1;
+    } else if (0 == strcmp("-D", a)) {
+      Dump = 2;
+    } else if (0 == strcmp("-s", a) && mod_idx + 1 < argc) {
+      seed = (u32)strtoul(argv[++mod_idx], NULL, 0);
+    } else if (0 == strcmp("-b", a) && mod_idx + 1 < argc) {
+      budget = strtoul(argv[++mod_idx], NULL, 0);
+    } else if (0 == strcmp("--perf-counters", a)) {
+      perf_counters = 1;
+    } else if (0 == strncmp("--export=", a, 9)) {
+      export = a + 9;
+    } else if (0 == strcmp("--vec", a)) {
+      Vec = 1;
+    } else if (0 == strcmp("--no-vec", a)) {
+      Vec = 0;
+    } else if (0 == strcmp("--no-const", a)) {
+      Const = CONST_OFF;
+    } else if (0 == strcmp("--reject-const", a)) {
+      Const = CONST_REJECT;
+    } else if (0 == strcmp("--no-screen", a)) {
+      Screen = 0;
+    } else if (0 == strcmp("--cache", a)) {
+      Cache = 1;
+    } else if (0 == strcmp("--no-cache", a)) {
+      Cache = 0;
+    } else if (0 == strncmp("--batch=", a, 8)) {
+      Batch = (int)strtoul(a + 8, NULL, 0);
+    } else if (0 == strcmp("--no-batch", a)) {
+      Batch = 0;
+    } else if (0 == strcmp("--split", a)) {
+      Split = 1;
+    } else if (0 == strcmp("--no-split", a)) {
+      Split = 0;
+    } else if (0 == strcmp("--verify", a)) {
+      Verify = 1;
+    } else if (0 == strcmp("-j", a) && mod_idx + 1 < argc) {
+      Verify_Threads = Enumerate_Threads = Split_Threads = Lex_Threads = (u32)strtoul(argv[++mod_idx], NULL, 0);
+    } else if (0 == strncmp("--enumerate=", a, 12)) {
+      Enumerate = (u32)strtoul(a + 12, NULL, 0);
+    } else if (0 == strncmp("--data=", a, 7)) {
+      data = a + 7;
+    } else if (0 == strncmp("--data-rows=", a, 12)) {
+      Data_Rows = (u32)strtoul(a + 12, NULL, 0);
+    } else if (0 == strcmp("--lexicase", a)) {
+      Lexicase = LEX_PLAIN;
+    } else if (0 == strcmp("--lexicase=eps", a)) {
+      Lexicase = LEX_EPS;
+    } else if (0 == strcmp("--speed", a)) {
+      Speed = 1;
+    } else if (0 == strcmp("--no-adapt", a)) {
+      Adapt = 0;
+    } else if (0 == strncmp("--adapt-load=", a, 13)) {
+      adapt_in = a + 13;
+    } else if (0 == strncmp("--adapt-save=", a, 13)) {
+      adapt_out = a + 13;
+    } else if (0 == strncmp("--trace=", a, 8)) {
+      trace = a + 8;
+    } else if (0 == strncmp("--trace-window=", a, 15)) {
+      if (2 != sscanf(a + 15, "%u,%u", &trace_first, &trace_count) || 0 == trace_count)
+        mod_idx = argc;
+    } else {
+      mod_idx = argc;
+    }
+  }
 
   if (argc <= mod_idx) {
-    printf("Usage: genx path/to/module\n");
+    printf("Usage: genx [-d|-D] [-s seed] [-b budget_sec] [--perf-counters]"
+           " [--vec|--no-vec] [--no-const|--reject-const] [--no-screen] [--cache|--no-cache] [--batch=rows|--no-batch] [--split|--no-split] [--verify] [-j threads] [--enumerate=len] [--data=file.csv|file.dat [--data-rows=n]] [--speed] [--lexicase[=eps]] [--export=prefix] [--no-adapt] [--adapt-load=in] [--adapt-save=out]"
+           " [--trace=out.json [--trace-window=first,count]]"
+           " path/to/module\n");
     exit(EXIT_FAILURE);
   }
 
@@ -175,22 +346,31 @@ int main(int argc, char *argv[])
   printf("sizeof Pop=%lu\n", (unsigned long)(sizeof Pop));
   printf("FLT_EPSILON=%g\n", FLT_EPSILON);
 
-  if (argc > 1) {
-    if (0 == strcmp("-d", argv[1])) {
-      Dump = 1;
-    } else if (0 == strcmp("-D", argv[1])) {
-      Dump = 2;
-    }
-    mod_idx += !!Dump;
-  }
-
   /* initialization */
   Iface = load_module(argv[mod_idx]);
-  assert(Iface);
+  if (NULL == Iface)
+    exit(EXIT_FAILURE);
   assert(Iface_Handle);
+  Iface = &Live;
+  if (NULL == data)
+    data = Iface->v2.path;
+  if (data) {
+    if (!data_load(&Live, data, Data_Rows, seed))
+      exit(EXIT_FAILURE);
+    if (Verify) {
+      /* the rows are the truth now, there's no func to sweep */
+      printf("verify: off with a dataset\n");
+      Verify = 0;
+    }
+  } else if (Live.v2.rows && !data_gen(&Live, seed)) {
+    exit(EXIT_FAILURE);
+  }
+  if (0 == Iface->test.i.data.len && SCORE_HASH != Iface->test.i.score) {
+    fprintf(stderr, "%s: no tests; a dataset module wants --data=file\n", argv[mod_idx]);
+    exit(EXIT_FAILURE);
+  }
   assert(Iface->opt.chromo_max > 0);
   assert(Iface->opt.pop_keep < Iface->opt.pop_size && "wtf are you doing");
-  assert(Iface->test.i.data.len > 0);
   genx_iface_dump(Iface);
   printf("CHROMO_SIZE(%p)..%u\n", (void*)Iface, CHROMO_SIZE(Iface));
   printf("sizeof(struct op)..%u\n", (unsigned)sizeof(struct op));
@@ -208,27 +388,75 @@ int main(int argc, char *argv[])
     }
   }
 
+  /* after init(), which may build the keys */
+  if (SCORE_HASH == Iface->test.i.score && !hash_init(Iface))
+    exit(EXIT_FAILURE);
+
   Best.geno.len = 0;
   Best.geno.chromo = malloc(CHROMO_SIZE(Iface) * sizeof(struct op));
 
   Tmp.geno.chromo = malloc(CHROMO_SIZE(Iface) * sizeof(struct op));
-  x86_init();
-  run_init();
-  rnd32_init((u32)time(NULL));
-  randr_test();
+  x86_init(Iface);
+  if (Dump)
+    x86_pick_report(stdout);
+  adapt_init();
+  if (Adapt && adapt_in && !adapt_load(adapt_in))
+    exit(EXIT_FAILURE);
+  run_init(Iface);
+  printf("seed=%" PRIu32 "\n", seed);
+  rnd32_stream(seed, 0);
+  if (Dump) {
+    randr_test();
+    rnd32_stream(seed, 0); /* the run doesn't see what the test drew */
+  }
 #ifndef WIN32
   nice(+19); /* be as polite to any other programs as possible */
 #endif
   pop_init(&Pop, Iface);
+  mon_init(1 + cpu_count(Split_Threads)); /* the main thread, and one pool's workers */
+  prof_init();
+  if (trace && !prof_trace(trace, trace_first, trace_count))
+    exit(EXIT_FAILURE);
+  if (perf_counters && !pmc_init())
+    exit(EXIT_FAILURE);
   Start = time(NULL);
   printf("Start=%lu\n", (unsigned long)Start);
 
-  evolve(&Best, &Tmp, &Pop, Iface, Start);
+  solved = Enumerate && enumerate(&Best, Iface);
+  if (!solved) {
+    solved = evolve(&Best, &Tmp, &Pop, Iface, Start, (time_t)budget, 0);
+    evolved = 1;
+  }
+  while (Verify && solved && GENOSCORE_MATCH(&Best)) {
+    struct genx_test cex[VERIFY_CEX_MAX];
+    u32 n = verify(&Best, Iface, cex, VERIFY_CEX_MAX);
+    if (0 == n)
+      break;
+    verify_grow(Iface, cex, n);
+    solved = !evolved && enumerate(&Best, Iface);
+    if (!solved) {
+      solved = evolve(&Best, &Tmp, &Pop, Iface, Start, (time_t)budget, evolved);
+      evolved = 1;
+    }
+  }
 
-  printf("done.\n");
+  printf("%s.\n", solved ? "done" : "budget exhausted");
   score(&Best, Iface, 1);
+  if (Speed && GENOSCORE_MATCH(&Best))
+    speed(&Best, Iface, 1);
+  if (export)
+    export_all(export, argv[mod_idx], &Best, Iface);
+  prof_report(stdout);
+  pmc_report(stdout);
+  adapt_report(stdout);
+  if (Adapt && adapt_out)
+    adapt_save(adapt_out);
+  pmc_fini();
+  split_fini();
+  prof_fini();
+  mon_fini();
   Iface = unload_module(Iface_Handle);
 
-  return 0;
+  return solved ? EXIT_SUCCESS : 2;
 }
 
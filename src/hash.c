@@ -0,0 +1,169 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * collisions are counted in an occupancy bitmap, one bit a bucket,
+ * cleared per candidate; avalanche flips HASH_FLIPS fixed bits of
+ * each of the first HASH_AVAL keys in a copy of the key. the timed
+ * pass is the best of HASH_TIMES, less what an empty step costs.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typ.h"
+#include "x86.h"
+#include "gen.h"
+#include "run.h"
+#include "prof.h"
+#include "hash.h"
+
+static u32 *Occ = NULL,   /* bucket bitmap */
+            Occ_Mask,
+            Occ_Words;
+static u8  *Flip = NULL;  /* the key being flipped */
+static u64  Bytes,        /* in all the keys */
+            Base;         /* cycles an empty step takes over them */
+
+static u32 hash_key(const u8 *code, const u8 *p, u32 len);
+
+/* hash every key, HASH_TIMES over; the fastest pass in cycles */
+static u64 hash_time(const u8 *code, const genx_iface *iface)
+{
+  const struct genx_key *k = iface->v2.hash.list;
+  volatile u32 sink = 0;
+  u64 best = ~0ULL,
+      t;
+  u32 i, j;
+  for (j = 0; j < HASH_TIMES; j++) {
+    t = prof_tsc();
+    for (i = 0; i < iface->v2.hash.len; i++)
+      sink += hash_key(code, k[i].p, k[i].len);
+    t = prof_tsc() - t;
+    if (t < best)
+      best = t;
+  }
+  (void)sink;
+  return best;
+}
+
+/* time a genotype with nothing between prologue and epilogue */
+static u64 hash_base(const genx_iface *iface)
+{
+  struct op op[GEN_PREFIX_LEN + GEN_SUFFIX_LEN];
+  genotype g = { 0, op, { 0, 0, { 0 } } };
+  u64 t;
+  u8 *code = code_page();
+  if (NULL == code)
+    return 0;
+  memset(op, 0, sizeof op);
+  GEN_PREFIX(&g);
+  g.len = GEN_PREFIX_LEN;
+  GEN_SUFFIX(&g);
+  gen_compile(&g, code, X86_BUFLEN);
+  t = hash_time(code, iface);
+  code_page_free(code);
+  return t;
+}
+
+int hash_init(const genx_iface *iface)
+{
+  const u32 n = iface->v2.hash.len;
+  u32 max = 4,
+      bits = 5,
+      i;
+  if (0 == n) {
+    fprintf(stderr, "hash: no keys\n");
+    return 0;
+  }
+  while (bits < 31 && (1U << bits) < n)
+    bits++;
+  Occ_Mask = (1U << bits) - 1;
+  Occ_Words = 1U << (bits - 5);
+  Bytes = 0;
+  for (i = 0; i < n; i++) {
+    Bytes += iface->v2.hash.list[i].len;
+    if (iface->v2.hash.list[i].len > max)
+      max = iface->v2.hash.list[i].len;
+  }
+  free(Occ);
+  free(Flip);
+  Occ = malloc(Occ_Words * sizeof *Occ);
+  Flip = malloc(max);
+  assert(Occ && Flip);
+  Base = iface->v2.hash.speed ? hash_base(iface) : 0;
+  printf("hash: %" PRIu32 " keys, %llu bytes, %" PRIu32 " buckets, an empty step %.2f cycles/16 bytes\n",
+    n, (unsigned long long)Bytes, Occ_Mask + 1, Bytes ? Base * 16. / Bytes : 0.);
+  return 1;
+}
+
+static u32 hash_key(const u8 *code, const u8 *p, u32 len)
+{
+  u32 h = HASH_SEED ^ len,
+      left = len,
+      w;
+  for (; left >= 4; p += 4, left -= 4) {
+    memcpy(&w, p, 4);
+    h = shim_i(code, h, w, left);
+  }
+  if (left) {
+    w = 0;
+    memcpy(&w, p, left);
+    h = shim_i(code, h, w, left);
+  }
+  return h;
+}
+
+/**
+ * @return collisions * HASH_COLL + avalanche error + speed * cycles/16 bytes
+ */
+u32 hash_score(const u8 *code, const genx_iface *iface, int verbose)
+{
+  const struct genx_key *k = iface->v2.hash.list;
+  const u32 n = iface->v2.hash.len;
+  u32 coll = 0,
+      aval = 0,
+      i, j;
+  u64 cyc = 0,
+      scor;
+  memset(Occ, 0, Occ_Words * sizeof *Occ);
+  for (i = 0; i < n; i++) {
+    u32 b = hash_key(code, k[i].p, k[i].len) & Occ_Mask;
+    coll += Occ[b >> 5] >> (b & 31) & 1;
+    Occ[b >> 5] |= 1U << (b & 31);
+  }
+  for (i = 0; i < n && i < HASH_AVAL; i++) {
+    const u32 bits = k[i].len * 8;
+    u32 h;
+    if (0 == bits)
+      continue;
+    memcpy(Flip, k[i].p, k[i].len);
+    h = hash_key(code, Flip, k[i].len);
+    for (j = 0; j < HASH_FLIPS; j++) {
+      const u32 b = (j * 0x9E3779B1U + i) % bits;
+      s32 d;
+      Flip[b >> 3] ^= (u8)(1 << (b & 7));
+      d = (s32)popcnt(h ^ hash_key(code, Flip, k[i].len)) - 16;
+      Flip[b >> 3] ^= (u8)(1 << (b & 7));
+      aval += (u32)(d < 0 ? -d : d);
+    }
+  }
+  scor = (u64)coll * HASH_COLL + aval;
+  if (iface->v2.hash.speed && Bytes) {
+    cyc = hash_time(code, iface);
+    cyc = cyc > Base ? cyc - Base : 0;
+    scor += cyc * 16 * iface->v2.hash.speed / Bytes;
+  }
+  if (verbose)
+    printf("hash: %" PRIu32 " collisions in %" PRIu32 " buckets, avalanche off by %" PRIu32
+           ", %.2f cycles/16 bytes over an empty step\n",
+      coll, Occ_Mask + 1, aval, Bytes ? cyc * 16. / Bytes : 0.);
+  return scor >= 0xFFFFFFFFU ? 0xFFFFFFFFU : (u32)scor;
+}
+
@@ -0,0 +1,40 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * SCORE_HASH: the candidate is the step of a string hash,
+ *
+ *   h = HASH_SEED ^ len
+ *   for each 32-bit word w of the key, the tail zero-padded:
+ *     h = candidate(h, w, bytes left)    eax, ebx, ecx
+ *
+ * genx does the loads and the loop, so the code itself never touches
+ * memory. the score is what it costs to use: keys colliding in a
+ * table of the next power of two up, how far flipping a key bit is
+ * from flipping half the hash, and, weighted by v2.hash.speed,
+ * the cycles it takes per 16 bytes. timings vary from run to run, so
+ * with a speed weight the score cache stays off.
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define HASH_SEED    0x9E3779B9U
+#define HASH_COLL    32  /* a collision costs this much avalanche  */
+#define HASH_AVAL    64  /* keys whose bits are flipped            */
+#define HASH_FLIPS   8   /* bits flipped in each                   */
+#define HASH_TIMES   2   /* timed passes, the fastest counts       */
+
+int hash_init(const genx_iface *);
+u32 hash_score(const u8 *code, const genx_iface *, int verbose);
+
+#endif
+
@@ -0,0 +1,266 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * the error matrix is one row of LEX_CASES u32s per population slot,
+ * written by score() as it goes and read here once pop_score() has
+ * sorted. picks are independent: pick j draws its case order from rnd
+ * stream j of a per-generation seed, so threads or not the same picks
+ * come out. eps is computed once per generation over everything that
+ * scored, as epsilon-lexicase does.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "typ.h"
+#include "rnd.h"
+#include "gen.h"
+#include "run.h"
+#include "lex.h"
+
+enum lex Lexicase = LEX_OFF;
+u32 Lex_Threads = 0;
+u32 Lex_Kept = 0;
+
+const struct genx_test *Lex_Rows = NULL;
+u32 Lex_Len = 0;
+
+static struct genx_test Lex_Pick[LEX_CASES];
+static u32 *Err = NULL,  /* pop_size rows of LEX_CASES */
+           *Pool = NULL, /* slots that scored */
+           *Tmp = NULL,
+            Pool_Len = 0,
+            Pop_Size = 0,
+            Eps[LEX_CASES],
+            Pick[LEX_PICKS],
+            Pick_Len = 0,
+            Seed;
+
+void lex_init(const genx_iface *iface)
+{
+  const u32 n = iface->test.i.data.len;
+  u32 i;
+  Lex_Len = 0;
+  Lex_Kept = 0;
+  Pick_Len = 0;
+  if (LEX_OFF == Lexicase || 0 == n
+   || SCORE_HASH == iface->test.i.score || SCORE_MPH == iface->test.i.score)
+    return;
+  if (n <= LEX_CASES) {
+    Lex_Rows = iface->test.i.data.list;
+    Lex_Len = n;
+  } else {
+    for (i = 0; i < LEX_CASES; i++)
+      Lex_Pick[i] = iface->test.i.data.list[(u64)i * n / LEX_CASES];
+    Lex_Rows = Lex_Pick;
+    Lex_Len = LEX_CASES;
+  }
+  if (iface->opt.pop_size > Pop_Size) {
+    free(Err);
+    free(Pool);
+    free(Tmp);
+    Pop_Size = iface->opt.pop_size;
+    Err = malloc((size_t)Pop_Size * LEX_CASES * sizeof *Err);
+    Pool = malloc(Pop_Size * sizeof *Pool);
+    Tmp = malloc(Pop_Size * sizeof *Tmp);
+    assert(Err && Pool && Tmp);
+  }
+}
+
+u32 *lex_row(u32 id)
+{
+  return Lex_Len ? Err + (size_t)id * LEX_CASES : NULL;
+}
+
+/* the k-th smallest of v[0..n); reorders v */
+static u32 nth(u32 *v, u32 n, u32 k)
+{
+  u32 lo = 0,
+      hi = n;
+  while (hi - lo > 1) {
+    const u32 piv = v[lo + (hi - lo) / 2];
+    u32 lt = lo, /* [lo,lt) < piv, [lt,i) == piv, [gt,hi) > piv */
+        gt = hi,
+        i = lo;
+    while (i < gt) {
+      const u32 x = v[i];
+      if (x < piv) {
+        v[i++] = v[lt];
+        v[lt++] = x;
+      } else if (x > piv) {
+        v[i] = v[--gt];
+        v[gt] = x;
+      } else {
+        i++;
+      }
+    }
+    if (k < lt)
+      hi = lt;
+    else if (k >= gt)
+      lo = gt;
+    else
+      return piv;
+  }
+  return v[k];
+}
+
+/* median absolute deviation of each case over the pool */
+static void lex_eps(void)
+{
+  u32 c, i, med;
+  for (c = 0; c < Lex_Len; c++) {
+    Eps[c] = 0;
+    if (LEX_EPS != Lexicase)
+      continue;
+    for (i = 0; i < Pool_Len; i++)
+      Tmp[i] = Err[(size_t)Pool[i] * LEX_CASES + c];
+    med = nth(Tmp, Pool_Len, Pool_Len / 2);
+    for (i = 0; i < Pool_Len; i++)
+      Tmp[i] = Tmp[i] > med ? Tmp[i] - med : med - Tmp[i];
+    Eps[c] = nth(Tmp, Pool_Len, Pool_Len / 2);
+  }
+}
+
+/* one pick; cand[] is scratch the size of the pool */
+static u32 lex_pick(u32 j, u32 *cand)
+{
+  u32 ord[LEX_CASES],
+      m = Pool_Len,
+      c, i, k;
+  rnd32_stream(Seed, j);
+  for (i = 0; i < Lex_Len; i++)
+    ord[i] = i;
+  memcpy(cand, Pool, m * sizeof *cand);
+  for (c = 0; c < Lex_Len && m > 1; c++) {
+    const u32 r = randr(c, Lex_Len - 1),
+              cs = ord[r];
+    u32 best = 0xFFFFFFFFU,
+        lim;
+    ord[r] = ord[c];
+    ord[c] = cs;
+    for (i = 0; i < m; i++)
+      if (Err[(size_t)cand[i] * LEX_CASES + cs] < best)
+        best = Err[(size_t)cand[i] * LEX_CASES + cs];
+    lim = best + Eps[cs] < best ? 0xFFFFFFFFU : best + Eps[cs];
+    for (i = k = 0; i < m; i++)
+      if (Err[(size_t)cand[i] * LEX_CASES + cs] <= lim)
+        cand[k++] = cand[i];
+    m = k;
+  }
+  return cand[randr(0, m - 1)];
+}
+
+struct lex_thread {
+  pthread_t th;
+  u32       first,
+            step,
+           *cand;
+};
+
+static void * lex_thread(void *arg)
+{
+  struct lex_thread *t = arg;
+  u32 j;
+  for (j = t->first; j < Pick_Len; j += t->step)
+    Pick[j] = lex_pick(j, t->cand);
+  return NULL;
+}
+
+/**
+ * called from pop_score() with p->scores[0..scored) sorted, before
+ * the elites move: pick the lexicase parents
+ */
+void lex_select(const struct pop *p, u32 scored, const genx_iface *iface)
+{
+  u32 threads = cpu_count(Lex_Threads),
+      i;
+  Pick_Len = 0;
+  Lex_Kept = 0;
+  if (0 == Lex_Len)
+    return;
+  for (i = Pool_Len = 0; i < scored; i++)
+    if (GENOSCORE_NOT_WORST(p->scores + i))
+      Pool[Pool_Len++] = p->scores[i].id;
+  if (Pool_Len < 2)
+    return;
+  Pick_Len = LEX_PICKS;
+  if (iface->opt.pop_keep + Pick_Len >= iface->opt.pop_size)
+    Pick_Len = iface->opt.pop_size - iface->opt.pop_keep - 1;
+  lex_eps();
+  Seed = rnd32();
+  if (threads > Pick_Len)
+    threads = Pick_Len;
+  if (threads < 2 || Pool_Len < LEX_PAR) {
+    u32 save[4];
+    memcpy(save, Rnd, sizeof save); /* the picks' streams aren't ours */
+    for (i = 0; i < Pick_Len; i++)
+      Pick[i] = lex_pick(i, Tmp);
+    memcpy(Rnd, save, sizeof save);
+  } else {
+    struct lex_thread t[threads];
+    for (i = 0; i < threads; i++) {
+      t[i].first = i;
+      t[i].step = threads;
+      t[i].cand = malloc(Pool_Len * sizeof *t[i].cand);
+      assert(t[i].cand);
+      if (pthread_create(&t[i].th, NULL, lex_thread, t + i)) {
+        perror("pthread_create");
+        abort();
+      }
+    }
+    for (i = 0; i < threads; i++) {
+      pthread_join(t[i].th, NULL);
+      free(t[i].cand);
+    }
+  }
+}
+
+void lex_moved(u32 a, u32 b)
+{
+  u32 j;
+  for (j = 0; j < Pick_Len; j++) {
+    if (a == Pick[j])
+      Pick[j] = b;
+    else if (b == Pick[j])
+      Pick[j] = a;
+  }
+}
+
+/**
+ * with the elites at the front, swap the picks in after them; a pick
+ * that is an elite or was picked already is copied, into the slots
+ * after the distinct ones
+ */
+void lex_place(struct pop *p, const genx_iface *iface, genoscore *tmp)
+{
+  u32 next = iface->opt.pop_keep,
+      dup[LEX_PICKS],
+      dups = 0,
+      j;
+  for (j = 0; j < Pick_Len; j++) {
+    const u32 src = Pick[j];
+    if (src < next) {
+      dup[dups++] = j;
+      continue;
+    }
+    if (src != next) {
+      genoscore_copy(tmp, p->indiv + next);
+      genoscore_copy(p->indiv + next, p->indiv + src);
+      genoscore_copy(p->indiv + src, tmp);
+      lex_moved(next, src);
+    }
+    next++;
+  }
+  for (j = 0; j < dups; j++)
+    genoscore_copy(p->indiv + next++, p->indiv + Pick[dup[j]]);
+  Lex_Kept = Pick_Len;
+}
+
@@ -0,0 +1,50 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * --lexicase[=eps]: besides the pop_keep elites, LEX_PICKS parents are
+ * picked by lexicase selection. each candidate that scores leaves its
+ * distance on every case, up to LEX_CASES rows spread over the table;
+ * a pick walks the cases in an order of its own and keeps only the
+ * candidates best on each (eps: within the case's median absolute
+ * deviation of best) until one is left. a few inputs with large
+ * errors can't drown out the rest the way they do in a sum.
+ */
+
+#ifndef LEX_H
+#define LEX_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define LEX_CASES 64 /* rows judged on; the table, or a spread of it   */
+#define LEX_PICKS 32 /* parents picked per generation                  */
+#define LEX_PAR   4096 /* scored candidates before picks go on threads */
+
+enum lex {
+  LEX_OFF,
+  LEX_PLAIN,
+  LEX_EPS
+};
+
+extern enum lex Lexicase;
+extern u32 Lex_Threads; /* -j; 0 is one per online cpu */
+extern u32 Lex_Kept;    /* parents pop_score() placed after the elites */
+
+/* the cases; run.c writes a row of LEX_CASES errors per candidate */
+extern const struct genx_test *Lex_Rows;
+extern u32 Lex_Len;
+
+void lex_init(const genx_iface *); /* from run_select(); Lex_Len 0 if it can't apply */
+u32 *lex_row(u32 id);              /* NULL when off */
+void lex_select(const struct pop *, u32 scored, const genx_iface *);
+void lex_moved(u32 a, u32 b);      /* pop_score() swapped indiv a and b */
+void lex_place(struct pop *, const genx_iface *, genoscore *tmp);
+
+#endif
+
@@ -0,0 +1,133 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#ifndef WIN32
+# include <unistd.h>
+# include <fcntl.h>
+# include <sys/mman.h> /* shm_open, mmap */
+#endif
+#include "typ.h"
+#include "mon.h"
+
+struct mon_stat Mon[MON_THREADS];
+
+static struct mon_page *Page = NULL;
+static char Page_Name[32];
+static volatile sig_atomic_t Dump_Req = 0;
+
+static void on_usr1(int sig)
+{
+  (void)sig;
+  Dump_Req = 1;
+}
+
+/**
+ * create the shared page; if that fails we still publish into
+ * private memory so callers need not care
+ */
+void mon_init(u32 threads)
+{
+  if (threads > MON_THREADS)
+    threads = MON_THREADS;
+#ifndef WIN32
+  {
+    int fd;
+    snprintf(Page_Name, sizeof Page_Name, MON_SHM_FMT, (unsigned long)getpid());
+    fd = shm_open(Page_Name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (-1 == fd) {
+      perror("shm_open");
+    } else if (-1 == ftruncate(fd, sizeof *Page)) {
+      perror("ftruncate");
+      close(fd);
+      shm_unlink(Page_Name);
+    } else {
+      Page = mmap(0, sizeof *Page, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      close(fd);
+      if (MAP_FAILED == Page) {
+        perror("mmap");
+        Page = NULL;
+        shm_unlink(Page_Name);
+      }
+    }
+    if (NULL == Page)
+      Page_Name[0] = '\0';
+  }
+  signal(SIGUSR1, on_usr1);
+#endif
+  if (NULL == Page) {
+    Page = malloc(sizeof *Page);
+    assert(NULL != Page);
+  }
+  memset(Page, 0, sizeof *Page);
+  Page->magic   = MON_MAGIC;
+  Page->version = MON_VERSION;
+#ifndef WIN32
+  Page->pid     = (u32)getpid();
+#endif
+  Page->threads = threads;
+  Page->start   = (u64)time(NULL);
+  Page->now     = Page->start;
+  printf("mon=%s\n", Page_Name[0] ? Page_Name : "(private)");
+}
+
+/**
+ * counters for worker thread i of a pool; pools take turns, so they
+ * share Mon[1..]. workers past the page count into a spare of their own
+ */
+struct mon_stat * mon_worker(u32 i)
+{
+  static __thread struct mon_stat Spare;
+  return 1 + i < MON_THREADS ? Mon + 1 + i : &Spare;
+}
+
+/**
+ * copy the local counters into the shared page; called once per
+ * generation, never from inside the evaluation loop
+ */
+void mon_publish(u64 gen, u64 best_score, u32 best_len)
+{
+  Page->seq++;
+  __sync_synchronize();
+  Page->gen        = gen;
+  Page->best_score = best_score;
+  Page->best_len   = best_len;
+  Page->now        = (u64)time(NULL);
+  memcpy(Page->thread, Mon, Page->threads * sizeof Mon[0]);
+  __sync_synchronize();
+  Page->seq++;
+}
+
+/**
+ * has someone sent us SIGUSR1 since we last asked?
+ */
+int mon_dump_requested(void)
+{
+  int req = Dump_Req;
+  Dump_Req = 0;
+  return req;
+}
+
+void mon_fini(void)
+{
+#ifndef WIN32
+  if (Page_Name[0]) {
+    munmap(Page, sizeof *Page);
+    shm_unlink(Page_Name);
+    Page_Name[0] = '\0';
+    Page = NULL;
+  }
+#endif
+}
+
@@ -0,0 +1,66 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * live run metrics, published in a shared memory page so that an
+ * external monitor (genx-top) can watch a run without disturbing it
+ */
+
+#ifndef MON_H
+#define MON_H
+
+#include "typ.h"
+
+#define MON_MAGIC     0x786e6567 /* "genx" */
+#define MON_VERSION   4
+#define MON_THREADS   32
+#define MON_SHM_FMT   "/genx.%lu" /* shm_open() name, by pid */
+
+/*
+ * counters updated by the evaluation loop; these live in ordinary
+ * process memory so the hot path never touches the shared page
+ */
+struct mon_stat {
+  u64 evals,        /* genotypes scored                       */
+      early_exit,   /* scoring cut short before the last test */
+      cache_lookup, /* candidate lookups in a score cache     */
+      cache_hit,
+      constant,     /* output provably independent of input   */
+      rows;         /* test rows run for split and --verify   */
+  u32 diversity;    /* distinct scores in the last generation */
+};
+
+extern struct mon_stat Mon[MON_THREADS]; /* [0] is the main thread */
+
+/*
+ * the shared page; written once per generation under a seqlock:
+ * 'seq' is odd while an update is in progress, readers retry
+ * until they see the same even value before and after copying
+ */
+struct mon_page {
+  u32 magic,
+      version,
+      pid,
+      threads;
+  volatile u32 seq;
+  u32 best_len;
+  u64 gen,
+      best_score,
+      start,        /* time(NULL) at start of evolution */
+      now;
+  struct mon_stat thread[MON_THREADS];
+};
+
+void mon_init(u32 threads);
+struct mon_stat * mon_worker(u32 i);
+void mon_publish(u64 gen, u64 best_score, u32 best_len);
+int  mon_dump_requested(void);
+void mon_fini(void);
+
+#endif
+
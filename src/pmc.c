@@ -0,0 +1,249 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * all counters are opened as one group so they are scheduled and
+ * read together; one read() at each end of the test loop gives
+ * the candidate-execution share, the remainder of a generation is
+ * bookkeeping. kernel time is excluded so the read()s themselves
+ * don't show up in the numbers. snapshots keep the raw counts and
+ * the group's enabled/running times; when the pmu has to multiplex
+ * the group, each difference of two snapshots is scaled up by its own
+ * enabled/running as perf does, so a sum of them never goes backwards.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# include <cpuid.h>
+# define PMC_HAVE_CPUID
+#endif
+#include "typ.h"
+#include "pmc.h"
+#ifdef linux
+# include <unistd.h>
+# include <sys/syscall.h>
+# include <sys/ioctl.h>
+# include <linux/perf_event.h>
+#endif
+
+int Pmc = 0;
+
+static const char *Event_Name[PMC_COUNT] = {
+  "cycles",
+  "instr",
+  "br-miss",
+  "ic-miss",
+  "itlb-miss",
+  "smc-clear"
+};
+
+static int Fd[PMC_COUNT],
+           Leader = -1,
+           Muxed = 0; /* a read saw the group off the pmu part of the time */
+static u32 Slot[PMC_COUNT], /* position of each event in a group read */
+           Nr = 0;
+
+/* a group read, raw */
+struct pmc_snap {
+  u64 enabled,
+      running,
+      val[PMC_COUNT];
+};
+
+static struct pmc_snap Exec_Begin,
+                       Mark;  /* at start of this generation */
+static u64 Exec[PMC_COUNT],   /* this generation */
+           Sum[PMC_PHASES][PMC_COUNT],
+           Gens = 0;
+
+static void pmc_read(struct pmc_snap *);
+
+/* each counter's change from a to b, scaled if the group was off the pmu in between */
+static void pmc_delta(const struct pmc_snap *a, const struct pmc_snap *b, u64 d[PMC_COUNT])
+{
+  const u64 en = b->enabled - a->enabled,
+            run = b->running - a->running;
+  u32 i;
+  for (i = 0; i < PMC_COUNT; i++)
+    d[i] = b->val[i] - a->val[i];
+  if (run < en) {
+    Muxed = 1;
+    for (i = 0; i < PMC_COUNT; i++)
+      d[i] = run ? (u64)((double)d[i] * en / run) : 0;
+  }
+}
+
+#ifdef linux
+
+static int open_event(u32 type, u64 config)
+{
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof attr);
+  attr.size           = sizeof attr;
+  attr.type           = type;
+  attr.config         = config;
+  attr.disabled       = -1 == Leader;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_GROUP
+                      | PERF_FORMAT_TOTAL_TIME_ENABLED
+                      | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return (int)syscall(__NR_perf_event_open, &attr, 0, -1, Leader, 0);
+}
+
+#define HW_CACHE(c, op, res) ((c) | ((op) << 8) | ((res) << 16))
+
+/* raw event codes are the vendor's own; 0x04c3 means something else on amd */
+static int pmc_intel(void)
+{
+#ifdef PMC_HAVE_CPUID
+  unsigned a, b, c, d;
+  if (__get_cpuid(0, &a, &b, &c, &d))
+    return 0x756e6547 == b && 0x49656e69 == d && 0x6c65746e == c; /* "GenuineIntel" */
+#endif
+  return 0;
+}
+
+/**
+ * open whatever this cpu/kernel lets us have; only cycles is
+ * required. returns 0 if counting is unavailable.
+ */
+int pmc_init(void)
+{
+  static const struct {
+    u32 type;
+    u64 config;
+  } Ev[PMC_COUNT] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(PERF_COUNT_HW_CACHE_L1I,
+                                   PERF_COUNT_HW_CACHE_OP_READ,
+                                   PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { PERF_TYPE_HW_CACHE, HW_CACHE(PERF_COUNT_HW_CACHE_ITLB,
+                                   PERF_COUNT_HW_CACHE_OP_READ,
+                                   PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    /* intel MACHINE_CLEARS.SMC; only asked for on intel */
+    { PERF_TYPE_RAW,      0x04c3 }
+  };
+  const int intel = pmc_intel();
+  u32 i;
+  for (i = 0; i < PMC_COUNT; i++) {
+    Fd[i] = PERF_TYPE_RAW == Ev[i].type && !intel ? -1 : open_event(Ev[i].type, Ev[i].config);
+    if (-1 == Fd[i]) {
+      if (0 == i) {
+        perror("perf_event_open");
+        return 0;
+      }
+      printf("pmc: %s unavailable\n", Event_Name[i]);
+      continue;
+    }
+    if (-1 == Leader)
+      Leader = Fd[i];
+    Slot[i] = Nr++;
+  }
+  ioctl(Leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(Leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  Pmc = 1;
+  pmc_read(&Mark);
+  return 1;
+}
+
+static void pmc_read(struct pmc_snap *v)
+{
+  struct {
+    u64 nr,
+        enabled,
+        running,
+        val[PMC_COUNT];
+  } r;
+  u32 i;
+  if (read(Leader, &r, sizeof r) < (ssize_t)(3 * sizeof(u64))) {
+    memset(v, 0, sizeof *v);
+    return;
+  }
+  v->enabled = r.enabled;
+  v->running = r.running;
+  for (i = 0; i < PMC_COUNT; i++)
+    v->val[i] = -1 == Fd[i] ? 0 : r.val[Slot[i]];
+}
+
+void pmc_fini(void)
+{
+  u32 i;
+  if (!Pmc) /* never opened; Fd[] isn't ours to close */
+    return;
+  for (i = 0; i < PMC_COUNT; i++)
+    if (Fd[i] != -1)
+      close(Fd[i]);
+  Leader = -1;
+  Pmc = 0;
+}
+
+#else
+
+int  pmc_init(void) { return 0; }
+static void pmc_read(struct pmc_snap *v) { memset(v, 0, sizeof *v); }
+void pmc_fini(void) { }
+
+#endif
+
+void pmc_exec_begin(void)
+{
+  pmc_read(&Exec_Begin);
+}
+
+void pmc_exec_end(void)
+{
+  struct pmc_snap v;
+  u64 d[PMC_COUNT];
+  u32 i;
+  pmc_read(&v);
+  pmc_delta(&Exec_Begin, &v, d);
+  for (i = 0; i < PMC_COUNT; i++)
+    Exec[i] += d[i];
+}
+
+/**
+ * close out a generation: whatever wasn't spent in the test loop
+ * was bookkeeping
+ */
+void pmc_gen_mark(void)
+{
+  struct pmc_snap v;
+  u64 all[PMC_COUNT];
+  u32 i;
+  pmc_read(&v);
+  pmc_delta(&Mark, &v, all);
+  for (i = 0; i < PMC_COUNT; i++) {
+    Sum[PMC_EXEC][i] += Exec[i];
+    Sum[PMC_BOOK][i] += all[i] > Exec[i] ? all[i] - Exec[i] : 0;
+    Exec[i] = 0;
+  }
+  Mark = v;
+  Gens++;
+}
+
+void pmc_report(FILE *f)
+{
+  static const char *Phase_Name[PMC_PHASES] = { "exec", "book" };
+  u32 p, i;
+  if (!Pmc || 0 == Gens)
+    return;
+  for (p = 0; p < PMC_PHASES; p++) {
+    const u64 *s = Sum[p];
+    fprintf(f, "PMC %-4s ipc %.2f", Phase_Name[p],
+      s[PMC_CYCLES] ? (double)s[PMC_INSTR] / s[PMC_CYCLES] : 0.);
+    for (i = 0; i < PMC_COUNT; i++)
+      if (Fd[i] != -1)
+        fprintf(f, " %s %.0f", Event_Name[i], (double)s[i] / Gens);
+    fprintf(f, " /gen%s\n", Muxed ? " (multiplexed, scaled)" : "");
+  }
+}
+
@@ -0,0 +1,46 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * hardware performance counters (linux perf_event_open) split
+ * between running candidates and everything else genx does
+ */
+
+#ifndef PMC_H
+#define PMC_H
+
+#include <stdio.h>
+#include "typ.h"
+
+enum pmc_event {
+  PMC_CYCLES,
+  PMC_INSTR,
+  PMC_BRMISS,   /* branch misses                         */
+  PMC_ICMISS,   /* L1 icache read misses                 */
+  PMC_ITLB,     /* iTLB read misses                      */
+  PMC_CLEARS,   /* machine clears, self-modifying code   */
+  PMC_COUNT     /* last, special */
+};
+
+enum pmc_phase {
+  PMC_EXEC,     /* the test loop in score()              */
+  PMC_BOOK,     /* mutation, compile, sort: the rest     */
+  PMC_PHASES    /* last, special */
+};
+
+extern int Pmc; /* counting enabled? */
+
+int  pmc_init(void);
+void pmc_exec_begin(void);
+void pmc_exec_end(void);
+void pmc_gen_mark(void);
+void pmc_report(FILE *);
+void pmc_fini(void);
+
+#endif
+
@@ -0,0 +1,61 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * no tests of its own: fit whatever table --data=file brings, e.g.
+ *
+ *   genx-data measurements.csv measurements.dat
+ *   genx --data=measurements.dat problems/dataset.so
+ *
+ * the file sets the number of inputs; a "weight" column makes some
+ * rows count more than others
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+static int done(const genoscore *);
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = NULL,
+    .func = NULL,
+    .done = done,
+    .data = {
+      .len  = 0,
+      .list = NULL
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+		.chromo_min     = 1,
+		.chromo_max     = DEFAULT_CHROMO_MAX,
+		.pop_size       = DEFAULT_POP_SIZE,
+		.pop_keep       = 1,
+		.gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+	    .int_ops      = 1,
+		  .float_ops    = 0,
+		  .algebra_ops  = 1,
+		  .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load(void)
+{
+  return &Iface;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
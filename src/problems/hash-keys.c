@@ -0,0 +1,87 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * a string hash for keys shaped like ours: short ids with a common
+ * prefix and mostly-digit tails, and longer URL paths. see hash.h for
+ * what the candidate is handed; run with -b, there's no perfect score.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "typ.h"
+#include "gen.h"
+
+static int init(void);
+static int done(const genoscore *);
+
+#define KEYS    2048
+#define KEY_MAX 40
+
+static char            Text[KEYS][KEY_MAX];
+static struct genx_key Key[KEYS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_HASH,
+    .max_const = 0xFFFFFFFF,
+    .init = init,
+    .func = NULL,
+    .done = done,
+    .data = {
+      .len  = 0,
+      .list = NULL
+    }
+  },
+  .opt = {
+    .param_cnt      = 3,
+		.chromo_min     = 1,
+		.chromo_max     = DEFAULT_CHROMO_MAX,
+		.pop_size       = DEFAULT_POP_SIZE / 16, /* a candidate hashes every key */
+		.pop_keep       = 4,
+		.gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+	    .int_ops      = 1,
+		  .float_ops    = 0,
+		  .algebra_ops  = 1,
+		  .bit_ops      = 1,
+      .random_const = 1
+    }
+  },
+  .v2 = {
+    .abi    = GENX_ABI,
+    .hash   = {
+      .len   = KEYS,
+      .list  = Key,
+      .speed = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load2(void)
+{
+  return &Iface;
+}
+
+static int init(void)
+{
+  for (unsigned i = 0; i < KEYS; i++) {
+    if (i % 4)
+      snprintf(Text[i], KEY_MAX, "user:%u", 100000 + i * 7);
+    else
+      snprintf(Text[i], KEY_MAX, "/api/v1/items/%u/detail", i * 131);
+    Key[i].p = (const u8 *)Text[i];
+    Key[i].len = (u32)strlen(Text[i]);
+  }
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  (void)best;
+  return 0;
+}
+
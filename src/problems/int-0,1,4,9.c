@@ -61,13 +61,18 @@ static const struct genx_iface Iface = {
 		  .bit_ops      = 1,
       .random_const = 1
     }
+  },
+  .v2 = {
+    .abi     = GENX_ABI,
+    .domains = 1,
+    .domain  = { { 0, 15 } }
   }
 };
 
 /**
  * interface loading hook
  */
-EXPORT const struct genx_iface * load(void)
+EXPORT const struct genx_iface * load2(void)
 {
   return &Iface;
 }
@@ -0,0 +1,87 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.HasZeroByte.32: 1 if any byte of a 32-bit word is zero, else 0
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 512
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 24,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  return 0 == (x[0] & 0x000000FF)
+      || 0 == (x[0] & 0x0000FF00)
+      || 0 == (x[0] & 0x00FF0000)
+      || 0 == (x[0] & 0xFF000000);
+}
+
+static int init(void)
+{
+  unsigned i;
+  u32 x = 0x2545F491;
+  for (i = 0; i < TESTS; i++) {
+    x = x * 1664525 + 1013904223;
+    /* random words rarely hold a zero byte; punch one in for half */
+    Test[i].in[0] = (i & 1) ? x : x & ~(0xFFU << (8 * ((x >> 8) & 3)));
+    Test[i].in[0] |= (i & 1) ? 0x01010101 : 0;
+    Test[i].out = func(Test[i].in);
+  }
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
@@ -0,0 +1,93 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.PopCnt.32: count the set bits in a 32-bit word
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 512
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 24,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  u32 v = x[0],
+      c = 0;
+  for (; v; v &= v - 1)
+    c++;
+  return c;
+}
+
+static int init(void)
+{
+  unsigned i;
+  u32 x = 0x12345678;
+  for (i = 0; i < 32; i++) {
+    Test[i].in[0] = 1U << i;          /* single bits          */
+    Test[i + 32].in[0] = ~(1U << i);  /* all but one bit      */
+  }
+  for (i = 64; i < TESTS; i++) {
+    x = x * 1664525 + 1013904223;     /* fixed lcg: same table every run */
+    Test[i].in[0] = x;
+  }
+  Test[64].in[0] = 0;
+  Test[65].in[0] = 0xFFFFFFFF;
+  for (i = 0; i < TESTS; i++)
+    Test[i].out = func(Test[i].in);
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
@@ -0,0 +1,89 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.PopCnt.8: count the set bits in a byte
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 256
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 16,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  },
+  .v2 = {
+    .abi     = GENX_ABI,
+    .domains = 1,
+    .domain  = { { 0, 0xFF } }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load2(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  u32 v = x[0] & 0xFF,
+      c = 0;
+  for (; v; v &= v - 1)
+    c++;
+  return c;
+}
+
+static int init(void)
+{
+  unsigned i;
+  for (i = 0; i < TESTS; i++) {
+    Test[i].in[0] = i;
+    Test[i].out = func(Test[i].in);
+  }
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
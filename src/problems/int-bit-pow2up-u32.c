@@ -0,0 +1,94 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.Pow2Up.U32: round up to the next highest power of 2;
+ * 0 and anything above 2^31 give 0, as the bit-twiddling version does
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 256
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 24,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  u32 p = 1;
+  if (0 == x[0] || x[0] > 0x80000000U)
+    return 0;
+  while (p < x[0])
+    p <<= 1;
+  return p;
+}
+
+static int init(void)
+{
+  unsigned i;
+  u32 x = 0x9E3779B9;
+  for (i = 0; i < 32; i++) {
+    Test[i * 3 + 0].in[0] = 1U << i;
+    Test[i * 3 + 1].in[0] = (1U << i) + 1;
+    Test[i * 3 + 2].in[0] = (1U << i) - 1;
+  }
+  for (i = 96; i < TESTS; i++) {
+    x = x * 1664525 + 1013904223;
+    Test[i].in[0] = x >> (x & 31);    /* spread over magnitudes */
+  }
+  for (i = 0; i < TESTS; i++)
+    Test[i].out = func(Test[i].in);
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
@@ -0,0 +1,90 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.Reverse.8: reverse the bits in a byte
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 256
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_BIT,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 24,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  },
+  .v2 = {
+    .abi     = GENX_ABI,
+    .domains = 1,
+    .domain  = { { 0, 0xFF } }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load2(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  u32 v = x[0] & 0xFF,
+      r = 0,
+      i;
+  for (i = 0; i < 8; i++)
+    r |= ((v >> i) & 1) << (7 - i);
+  return r;
+}
+
+static int init(void)
+{
+  unsigned i;
+  for (i = 0; i < TESTS; i++) {
+    Test[i].in[0] = i;
+    Test[i].out = func(Test[i].in);
+  }
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
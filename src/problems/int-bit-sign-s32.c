@@ -0,0 +1,92 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Int.Bit.Sign.S32: -1, 0 or +1 according to the sign of a signed word
+ * from the Bit-Twiddling Hacks list in doc/potential-uses.txt
+ */
+
+#include <stdio.h>
+#include "typ.h"
+#include "gen.h"
+
+#define TESTS 256
+
+static int init(void);
+static u32 func(const u32 []);
+static int done(const genoscore *);
+
+static struct {
+  u32 in[4],
+      out;
+} Test[TESTS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_ALG,
+    .max_const = 0xFFFF,
+    .init = init,
+    .func = func,
+    .done = done,
+    .data = {
+      .len  = sizeof Test / sizeof Test[0],
+      .list = (void *)Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 1,
+    .chromo_min     = 1,
+    .chromo_max     = 16,
+    .pop_size       = DEFAULT_POP_SIZE,
+    .pop_keep       = 3,
+    .gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+      .int_ops      = 1,
+      .float_ops    = 0,
+      .algebra_ops  = 1,
+      .bit_ops      = 1,
+      .random_const = 1
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load(void)
+{
+  return &Iface;
+}
+
+static u32 func(const u32 x[])
+{
+  s32 v = (s32)x[0];
+  return (u32)((v > 0) - (v < 0));
+}
+
+static int init(void)
+{
+  unsigned i;
+  u32 x = 0xDEADBEEF;
+  for (i = 0; i < TESTS; i++) {
+    x = x * 1664525 + 1013904223;
+    Test[i].in[0] = x >> (x & 31);
+    if (i & 1)
+      Test[i].in[0] = -Test[i].in[0];
+  }
+  Test[0].in[0] = 0;
+  Test[1].in[0] = 1;
+  Test[2].in[0] = 0x7FFFFFFF;
+  Test[3].in[0] = 0x80000000;
+  Test[4].in[0] = 0xFFFFFFFF;
+  Test[5].in[0] = 0xFFFFFFFE;
+  for (i = 0; i < TESTS; i++)
+    Test[i].out = func(Test[i].in);
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
@@ -11,12 +11,25 @@
 
 static int init(void);
 static u32 isPerfectSquare(const u32 []);
+static void inputs(u32 *const [3], u32, u32);
+static void ref(const u32 *const [3], u32 *, u32);
 static int done(const genoscore *);
 
+/*
+ * ABI v2: genx builds TESTS rows from inputs() and ref(), the
+ * hand-picked ones first, then squares and their neighbours drawn
+ * afresh every REFRESH generations. the first SCREEN hand-picked rows
+ * are what every candidate runs before the rest; init() fills in
+ * their outputs.
+ */
+#define TESTS   4096
+#define SCREEN  16
+#define REFRESH 100
+
 static struct {
   u32 in[4],
       out;
-} Test[] = {
+} Picked[] = {
   { { 0xFFFFFFFF }, 0 },
   { {  0xFFFFFFF }, 0 },
   { {  0x100000A }, 0 },
@@ -64,6 +77,8 @@ static struct {
   { {          0 }, 0 },
 };
 
+#define PICKED (sizeof Picked / sizeof Picked[0])
+
 static const struct genx_iface Iface = {
   .test.i = {
     .score = SCORE_ALG,
@@ -72,8 +87,8 @@ static const struct genx_iface Iface = {
     .func = isPerfectSquare,
     .done = done,
     .data = {
-      .len  = sizeof Test / sizeof Test[0],
-      .list = &Test
+      .len  = 0, /* see v2 */
+      .list = NULL
     }
   },
   .opt = {
@@ -91,13 +106,26 @@ static const struct genx_iface Iface = {
 		  .bit_ops      = 1,
       .random_const = 1
     }
+  },
+  .v2 = {
+    .abi     = GENX_ABI,
+    .rows    = TESTS,
+    .refresh = REFRESH,
+    .domains = 1,
+    .domain  = { { 0, 0xFFFFFFFF } },
+    .inputs  = inputs,
+    .ref     = ref,
+    .screen  = {
+      .len  = SCREEN,
+      .list = &Picked
+    }
   }
 };
 
 /**
  * interface loading hook
  */
-EXPORT const struct genx_iface * load(void)
+EXPORT const struct genx_iface * load2(void)
 {
   return &Iface;
 }
@@ -108,10 +136,44 @@ static u32 isPerfectSquare(const u32 x[])
   return s * s == x[0];
 }
 
+static void ref(const u32 *const in[3], u32 *out, u32 n)
+{
+  for (u32 i = 0; i < n; i++) {
+    u32 s = (u32)(sqrt(in[0][i]) + 0.5);
+    out[i] = s * s == in[0][i];
+  }
+}
+
+static void inputs(u32 *const in[3], u32 n, u32 seed)
+{
+  u32 x = seed | 1;
+  for (u32 i = 0; i < n; i++) {
+    u32 k;
+    in[1][i] = in[2][i] = 0;
+    if (i < PICKED) {
+      in[0][i] = Picked[i].in[0];
+      continue;
+    }
+    if (0 == (i - PICKED) % 3) { /* xorshift32; a new root every third row */
+      x ^= x << 13;
+      x ^= x >> 17;
+      x ^= x << 5;
+    }
+    k = x & 0xFFFF;
+    in[0][i] = k * k + (i - PICKED) % 3 - 1; /* k*k-1, k*k, k*k+1 */
+  }
+}
+
 static int init(void)
 {
-  for (unsigned i = 0; i < sizeof Test / sizeof Test[0]; i++)
-    Test[i].out = isPerfectSquare(Test[i].in);
+  u32 in[PICKED],
+      out[PICKED];
+  const u32 *const cols[3] = { in, in, in };
+  for (unsigned i = 0; i < PICKED; i++)
+    in[i] = Picked[i].in[0];
+  ref(cols, out, PICKED);
+  for (unsigned i = 0; i < PICKED; i++)
+    Picked[i].out = out[i];
   return 1;
 }
 
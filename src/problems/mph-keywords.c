@@ -0,0 +1,90 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * a minimal perfect hash of the C89 keywords, for a 32-entry lookup
+ * table: each keyword comes in as its first four bytes, its last four
+ * and its length, and must get a slot of its own. the hash is the
+ * output & 31.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "typ.h"
+#include "gen.h"
+
+static int init(void);
+static int done(const genoscore *);
+
+static const char *Word[] = {
+  "auto", "break", "case", "char", "const", "continue", "default", "do",
+  "double", "else", "enum", "extern", "float", "for", "goto", "if",
+  "int", "long", "register", "return", "short", "signed", "sizeof", "static",
+  "struct", "switch", "typedef", "union", "unsigned", "void", "volatile", "while"
+};
+
+#define KEYS (sizeof Word / sizeof Word[0])
+
+static struct genx_test Test[KEYS];
+
+static const struct genx_iface Iface = {
+  .test.i = {
+    .score = SCORE_MPH,
+    .max_const = 0xFF,
+    .init = init,
+    .func = NULL,
+    .done = done,
+    .data = {
+      .len  = KEYS,
+      .list = Test
+    }
+  },
+  .opt = {
+    .param_cnt      = 3,
+		.chromo_min     = 1,
+		.chromo_max     = DEFAULT_CHROMO_MAX,
+		.pop_size       = DEFAULT_POP_SIZE,
+		.pop_keep       = 4,
+		.gen_deadend    = 0,
+    .mutate_rate    = 0.5,
+    .x86 = {
+	    .int_ops      = 1,
+		  .float_ops    = 0,
+		  .algebra_ops  = 1,
+		  .bit_ops      = 1,
+      .random_const = 1
+    }
+  },
+  .v2 = {
+    .abi    = GENX_ABI,
+    .mph    = {
+      .slots = KEYS
+    }
+  }
+};
+
+/**
+ * interface loading hook
+ */
+EXPORT const struct genx_iface * load2(void)
+{
+  return &Iface;
+}
+
+/* words shorter than four are zero-padded; both ends then overlap */
+static int init(void)
+{
+  for (unsigned i = 0; i < KEYS; i++) {
+    const size_t len = strlen(Word[i]);
+    memset(Test + i, 0, sizeof Test[i]);
+    memcpy(&Test[i].in[0], Word[i], len < 4 ? len : 4);
+    memcpy(&Test[i].in[1], Word[i] + (len < 4 ? 0 : len - 4), len < 4 ? len : 4);
+    Test[i].in[2] = (u32)len;
+  }
+  return 1;
+}
+
+static int done(const genoscore *best)
+{
+  return GENOSCORE_MATCH(best);
+}
+
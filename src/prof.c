@@ -0,0 +1,171 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * trace output is the Chrome "Trace Event Format", loadable by
+ * chrome://tracing and ui.perfetto.dev
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "typ.h"
+#include "prof.h"
+
+struct prof Prof[MON_THREADS];
+
+static const char *Phase_Name[PROF_COUNT] = {
+  "gen",
+  "compile",
+  "exec",
+  "score",
+  "sort"
+};
+
+static double Tsc_Per_Usec = 1.;
+static u64    Tsc_Start;
+static u32    Gen = 0,   /* generation currently running */
+              Gens = 0;  /* generations completed        */
+
+static FILE  *Trace = NULL;
+static u32    Trace_First,
+              Trace_Last;
+static int    Trace_Events = 0;
+
+/**
+ * measure the tsc rate against the monotonic clock so trace
+ * timestamps come out in microseconds
+ */
+void prof_init(void)
+{
+  struct timespec a, b, nap = { 0, 50 * 1000 * 1000 };
+  u64 ta, tb;
+  double usec;
+  clock_gettime(CLOCK_MONOTONIC, &a);
+  ta = prof_tsc();
+  nanosleep(&nap, NULL);
+  clock_gettime(CLOCK_MONOTONIC, &b);
+  tb = prof_tsc();
+  usec = (b.tv_sec - a.tv_sec) * 1e6 + (b.tv_nsec - a.tv_nsec) / 1e3;
+  if (usec > 0. && tb > ta)
+    Tsc_Per_Usec = (double)(tb - ta) / usec;
+  Tsc_Start = prof_tsc();
+  printf("tsc=%.1fMHz\n", Tsc_Per_Usec);
+}
+
+static int tracing(void)
+{
+  return Trace && Gen >= Trace_First && Gen <= Trace_Last;
+}
+
+static void trace_event(const char *name, const char *ph, u64 t, u64 dur, u32 tid)
+{
+  fprintf(Trace, "%s{\"name\":\"%s\",\"cat\":\"genx\",\"ph\":\"%s\","
+                 "\"ts\":%.3f,\"pid\":1,\"tid\":%" PRIu32,
+    Trace_Events++ ? ",\n" : "", name, ph,
+    (double)(t - Tsc_Start) / Tsc_Per_Usec, tid);
+  if ('X' == *ph)
+    fprintf(Trace, ",\"dur\":%.3f", (double)dur / Tsc_Per_Usec);
+  fprintf(Trace, ",\"args\":{\"gen\":%" PRIu32 "}}", Gen);
+}
+
+/**
+ * record a phase that happens once per generation; 'phase' may be
+ * PROF_COUNT for spans that only exist to group others in the trace
+ */
+void prof_span(enum prof_phase phase, const char *name, u64 t0, u64 t1)
+{
+  if (phase < PROF_COUNT)
+    Prof[0].cyc[phase] += t1 - t0;
+  if (tracing())
+    trace_event(name, "X", t0, t1 - t0, 0);
+}
+
+/**
+ * split the test loop time between exec and score, fold this
+ * generation into the run totals and start the next one
+ */
+void prof_gen_end(u32 gen)
+{
+  u32 t, i;
+  u64 now = prof_tsc();
+  for (t = 0; t < MON_THREADS; t++) {
+    struct prof *p = Prof + t;
+    u64 exec = p->loop;
+    if (0 == p->loop && 0 == p->cyc[PROF_GEN] && 0 == p->cyc[PROF_COMPILE])
+      continue;
+    if (p->samp_loop > 0 && p->samp_exec <= p->samp_loop)
+      exec = (u64)((double)p->loop * p->samp_exec / p->samp_loop);
+    p->cyc[PROF_EXEC]  += exec;
+    p->cyc[PROF_SCORE] += p->loop - exec;
+    if (tracing()) {
+      fprintf(Trace, "%s{\"name\":\"cycles\",\"ph\":\"C\",\"ts\":%.3f,"
+                     "\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{",
+        Trace_Events++ ? ",\n" : "", (double)(now - Tsc_Start) / Tsc_Per_Usec, t);
+      for (i = 0; i < PROF_COUNT; i++)
+        fprintf(Trace, "%s\"%s\":%" PRIu64, i ? "," : "", Phase_Name[i], p->cyc[i]);
+      fprintf(Trace, "}}");
+    }
+    for (i = 0; i < PROF_COUNT; i++)
+      p->total[i] += p->cyc[i];
+    memset(p->cyc, 0, sizeof p->cyc);
+    p->loop = p->samp_exec = p->samp_loop = 0;
+  }
+  Gen = gen + 1;
+  Gens++;
+}
+
+/**
+ * share of time per phase over the whole run
+ */
+void prof_report(FILE *f)
+{
+  u64 sum = 0;
+  u32 i, t;
+  u64 tot[PROF_COUNT];
+  memset(tot, 0, sizeof tot);
+  for (t = 0; t < MON_THREADS; t++)
+    for (i = 0; i < PROF_COUNT; i++)
+      tot[i] += Prof[t].total[i];
+  for (i = 0; i < PROF_COUNT; i++)
+    sum += tot[i];
+  if (0 == sum || 0 == Gens)
+    return;
+  fprintf(f, "PHASE");
+  for (i = 0; i < PROF_COUNT; i++)
+    fprintf(f, " %s %.1f%%", Phase_Name[i], 100. * tot[i] / sum);
+  fprintf(f, " (%.2fMcyc/gen)\n", (double)sum / Gens / 1e6);
+}
+
+/**
+ * write a trace of generations [first, first+count) to 'path'
+ */
+int prof_trace(const char *path, u32 first, u32 count)
+{
+  assert(count > 0);
+  Trace = fopen(path, "w");
+  if (NULL == Trace) {
+    perror(path);
+    return 0;
+  }
+  Trace_First = first;
+  Trace_Last = first + count - 1;
+  fprintf(Trace, "{\"traceEvents\":[\n");
+  return 1;
+}
+
+void prof_fini(void)
+{
+  if (Trace) {
+    fprintf(Trace, "\n]}\n");
+    fclose(Trace);
+    Trace = NULL;
+  }
+}
+
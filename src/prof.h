@@ -0,0 +1,66 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * per-phase cycle accounting via rdtsc; always on, cheap enough
+ * to leave on: a handful of rdtsc per candidate
+ */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdio.h>
+#include "typ.h"
+#include "mon.h"
+
+enum prof_phase {
+  PROF_GEN,     /* pop_gen(): mutation and rng       */
+  PROF_COMPILE, /* gen_compile()                     */
+  PROF_EXEC,    /* shim_i(): running the candidate   */
+  PROF_SCORE,   /* distance arithmetic around exec   */
+  PROF_SORT,    /* qsort() in pop_score()            */
+  PROF_COUNT    /* last, special */
+};
+
+/*
+ * execution vs. scoring arithmetic can't be told apart without
+ * timing every single call; we do that for 1 in PROF_SAMPLE
+ * candidates and split the total test loop time by that ratio
+ */
+#define PROF_SAMPLE 64
+
+struct prof {
+  u64 cyc[PROF_COUNT],  /* this generation                 */
+      total[PROF_COUNT],/* whole run                       */
+      loop,             /* test loop cycles, exec + score  */
+      samp_exec,        /* sampled candidates: exec only   */
+      samp_loop;        /* sampled candidates: whole loop  */
+  u32 cand;             /* candidates seen, for sampling   */
+};
+
+extern struct prof Prof[MON_THREADS];
+
+static inline u64 prof_tsc(void)
+{
+  u32 lo, hi;
+  __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((u64)hi << 32) | lo;
+}
+
+/* should the current candidate have its calls timed individually? */
+#define prof_sample(p) (0 == ((p)->cand++ % PROF_SAMPLE))
+
+void prof_init(void);
+void prof_span(enum prof_phase, const char *name, u64 t0, u64 t1);
+void prof_gen_end(u32 gen);
+void prof_report(FILE *);
+int  prof_trace(const char *path, u32 first, u32 count);
+void prof_fini(void);
+
+#endif
+
@@ -30,7 +30,7 @@ void rnd32_init(u32 seed)
 }
 #endif
 
-#if 1
+#if 0
 /*
  * custom, unstrusted, fast bitwise prng from the web :/
  */
@@ -57,6 +57,89 @@ void rnd32_init(u32 seed)
 
 #endif
 
+#if 1
+/*
+ * xoshiro128** by David Blackman and Sebastiano Vigna
+ * <URL: http://prng.di.unimi.it/xoshiro128starstar.c>
+ * 128 bits of state, period 2^128-1, passes BigCrush; rnd32() itself
+ * is inline in rnd.h. state is per-thread so workers never share
+ * or contend on it.
+ */
+__thread u32 Rnd[4];
+
+/**
+ * splitmix32; spreads a 32-bit seed over the whole state so that
+ * nearby seeds give unrelated streams
+ */
+static u32 splitmix32(u32 *x)
+{
+  u32 z = (*x += 0x9E3779B9);
+  z = (z ^ (z >> 16)) * 0x85EBCA6B;
+  z = (z ^ (z >> 13)) * 0xC2B2AE35;
+  return z ^ (z >> 16);
+}
+
+void rnd32_init(u32 seed)
+{
+  u32 i;
+  for (i = 0; i < 4; i++)
+    Rnd[i] = splitmix32(&seed);
+  if (0 == (Rnd[0] | Rnd[1] | Rnd[2] | Rnd[3])) /* the one bad state */
+    Rnd[0] = 1;
+}
+
+/**
+ * advance the calling thread's state by 2^64 draws; streams that
+ * are whole jumps apart never overlap in practice
+ */
+void rnd32_jump(void)
+{
+  static const u32 Jump[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+  u32 s[4] = { 0, 0, 0, 0 },
+      i, b;
+  for (i = 0; i < 4; i++) {
+    for (b = 0; b < 32; b++) {
+      if (Jump[i] & (1U << b)) {
+        s[0] ^= Rnd[0];
+        s[1] ^= Rnd[1];
+        s[2] ^= Rnd[2];
+        s[3] ^= Rnd[3];
+      }
+      (void)rnd32();
+    }
+  }
+  Rnd[0] = s[0];
+  Rnd[1] = s[1];
+  Rnd[2] = s[2];
+  Rnd[3] = s[3];
+}
+
+/**
+ * seed the calling thread as stream 'n' of 'seed': the same
+ * (seed, n) always replays the same sequence, whichever thread
+ * or however many threads a run uses
+ */
+void rnd32_stream(u32 seed, u32 n)
+{
+  rnd32_init(seed);
+  while (n--)
+    rnd32_jump();
+}
+
+void rnd32_fill(u32 *dst, size_t n)
+{
+  while (n--)
+    *dst++ = rnd32();
+}
+
+void randr_fill(u32 *dst, size_t n, u32 min, u32 max)
+{
+  while (n--)
+    *dst++ = randr(min, max);
+}
+
+#endif
+
 #if 0
 
 /**
@@ -106,26 +189,9 @@ static void rnd_init(u32 seed)
  * ranged random u32
  */
 #define randr(min, max) ((min) + (rnd() % ((max) - (min) + 1)))
-
-#else
-
-/**
- * ranged [min, max] u32
- * NOTE: this function gets called ALOT
- *       make it faster(!)
- */
-u32 randr(u32 min, u32 max)
-{
-#if 0
-  /* this is the more proper way, but it's slower because it uses division! */
-  double scaled = (double)rnd32() / (double)0xFFFFFFFF;
-  u32 r = min + ((max - min + 1) * scaled);
-#else
-  /* trade quicker time for lower quality psuedo-random numbers */
-  u32 r = min + (rnd32() % (max - min + 1));
 #endif
-  return r;
-}
+
+#if 1
 
 static void hist_print(const u32 n[], size_t len)
 {
@@ -174,14 +240,6 @@ void randr_test(void)
   printf("randr(lo, hi) test done.\n");
 }
 
-float rand01(void)
-{
-  float r = (float)randr(0, 99999) / (float)100000;
-  assert(r >= 0.f);
-  assert(r < 1.f);
-  return r;
-}
-
 float randfr(float min, float max)
 {
   float r = min + ((max - min + 1) * rand01());
@@ -17,22 +17,67 @@
 float drand48(void);
 #endif
 
+/*
+ * xoshiro128** state, one per thread; see rnd.c
+ */
+extern __thread u32 Rnd[4];
+
 void rnd32_init(u32);
+void rnd32_stream(u32 seed, u32 n);
+void rnd32_jump(void);
+
+static inline u32 rnd_rotl(const u32 x, int k)
+{
+  return (x << k) | (x >> (32 - k));
+}
+
 #if 1
-u32  rnd32(void);
+static inline u32 rnd32(void)
+{
+  const u32 r = rnd_rotl(Rnd[1] * 5, 7) * 9,
+            t = Rnd[1] << 9;
+  Rnd[2] ^= Rnd[0];
+  Rnd[3] ^= Rnd[1];
+  Rnd[1] ^= Rnd[2];
+  Rnd[0] ^= Rnd[3];
+  Rnd[2] ^= t;
+  Rnd[3] = rnd_rotl(Rnd[3], 11);
+  return r;
+}
 #else
 //# define rnd32() random()
 #endif
 
-u32  randr(u32 min, u32 max);
+/**
+ * ranged [min, max] u32
+ * NOTE: this function gets called ALOT
+ *       multiply-shift instead of modulo, so no division. it isn't
+ *       unbiased: unless range divides 2^32 some results come up
+ *       1/2^32 more often than others, spread over the range rather
+ *       than bunched at the low end as with modulo
+ */
+static inline u32 randr(u32 min, u32 max)
+{
+  const u32 range = max - min + 1;
+  if (0 == range) /* [0, 0xFFFFFFFF] */
+    return rnd32();
+  return min + (u32)(((u64)rnd32() * range) >> 32);
+}
+
+void rnd32_fill(u32 *dst, size_t n);
+void randr_fill(u32 *dst, size_t n, u32 min, u32 max);
 void randr_test(void);
 
 /**
- * return a random double within the range [0.0, 1.0)
+ * return a random float within the range [0.0, 1.0);
+ * the top 24 bits are exactly representable
  */
 //#define rand01()  drand48()
+static inline float rand01(void)
+{
+  return (float)(rnd32() >> 8) * (1.f / 16777216.f);
+}
 
-float rand01(void);
 float randfr(float min, float max);
 
 #endif
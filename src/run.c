@@ -10,9 +10,11 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <float.h>
 #include <math.h>
 #include <limits.h>
+#include <unistd.h>
 #ifdef linux
 # include <sys/mman.h> /* mmap */
 # include <sys/types.h>
@@ -21,9 +23,59 @@
 #include "typ.h"
 #include "x86.h"
 #include "run.h"
+#include "mon.h"
+#include "prof.h"
+#include "pmc.h"
+#include "dist.h"
+#include "eff.h"
+#include "canon.h"
+#include "rnd.h"
+#include "split.h"
+#include "hash.h"
+#include "lex.h"
 
 extern int Dump;
 
+/**
+ * a writable, executable X86_BUFLEN buffer to compile candidates into
+ * @return NULL if there's none to be had
+ */
+u8 * code_page(void)
+{
+  u8 *code;
+#ifdef linux
+  code = mmap(0, X86_BUFLEN, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (MAP_FAILED == code) {
+    perror("mmap");
+    return NULL;
+  }
+#else
+  code = malloc(X86_BUFLEN);
+#endif
+  return code;
+}
+
+void code_page_free(u8 *code)
+{
+#ifdef linux
+  munmap(code, X86_BUFLEN);
+#else
+  free(code);
+#endif
+}
+
+/**
+ * @return want, or one per online cpu if it's 0
+ */
+u32 cpu_count(u32 want)
+{
+  long n;
+  if (want)
+    return want;
+  n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (u32)n : 1;
+}
+
 #if 0
 static float score_f(const void *f, int verbose);
 static u32   score_i(const void *f, int verbose);
@@ -119,13 +171,519 @@ static float score_f(const void *f, int verbose)
 
 #else /* integer */
 
-static u32 shim_i(const void *, u32, u32, u32) NOINLINE;
-static u32 popcnt(u32 n);
-
 static u8 *x86;
-#define X86_BUFLEN 4096
 
-void run_init(void)
+/*
+ * the hot loop: run every test, accumulate distance, nothing else.
+ * one kernel per score type and overflow policy, picked once by
+ * run_select(); printing lives in score_report().
+ */
+typedef u32 (*score_kernel)(const u8 *code, const struct genx_test *t, u32 n);
+
+/* popcnt distance is at most 32 per test; can't overflow below 2^27 tests */
+static u32 kernel_bit(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u32 scor = 0, i;
+  for (i = 0; i < n; i++)
+    scor += popcnt(shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]) ^ t[i].out);
+  return scor;
+}
+
+/* saturate at 0xFFFFFFFF and stop; nothing is worse than that */
+static u32 kernel_bit_sat(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u32 scor = 0, i;
+  for (i = 0; i < n; i++) {
+    u32 diff = popcnt(shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]) ^ t[i].out);
+    if (0xFFFFFFFFU - diff < scor)
+      return 0xFFFFFFFFU;
+    scor += diff;
+  }
+  return scor;
+}
+
+static u32 kernel_alg_sat(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u32 scor = 0, i;
+  for (i = 0; i < n; i++) {
+    u32 diff = alg_diff(t[i].out, shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]));
+    if (0xFFFFFFFFU - diff < scor)
+      return 0xFFFFFFFFU;
+    scor += diff;
+  }
+  return scor;
+}
+
+static const u32 *Weight = NULL; /* v2.weight, for the _wt kernels */
+
+/* row i counts Weight[i] times; u64 until the end, then saturate */
+static u32 kernel_bit_wt(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < n; i++) {
+    scor += (u64)Weight[i] * popcnt(shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]) ^ t[i].out);
+    if (scor >= 0xFFFFFFFFU)
+      return 0xFFFFFFFFU;
+  }
+  return (u32)scor;
+}
+
+static u32 kernel_alg_wt(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < n; i++) {
+    scor += (u64)Weight[i] * alg_diff(t[i].out, shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]));
+    if (scor >= 0xFFFFFFFFU)
+      return 0xFFFFFFFFU;
+  }
+  return (u32)scor;
+}
+
+int Vec = -1; /* collect outputs and reduce them in one pass? -1: auto */
+
+static const struct dist *Dist_Be;
+static dist_fn Dist_Fn;
+static u32    *Want = NULL, /* expected outputs, columnar */
+              *Got = NULL,  /* a candidate's outputs      */
+               Want_Len = 0;
+
+/*
+ * run everything, then one SIMD pass over the outputs; no early exit,
+ * but 64-bit accumulation means no per-test overflow test either
+ */
+static u32 kernel_vec(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u64 d;
+  u32 i;
+  for (i = 0; i < n; i++)
+    Got[i] = shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]);
+  d = Dist_Fn(Got, Want, n);
+  return d > 0xFFFFFFFFU ? 0xFFFFFFFFU : (u32)d;
+}
+
+/*
+ * --lexicase: where score() leaves the candidate's distance on each of
+ * Lex_Rows, NULL otherwise. when those are the table, the kernel that
+ * scores it writes them too.
+ */
+static u32 *Err_Row = NULL;
+static int  Err_Bit = 0;
+
+static u32 kernel_err(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < n; i++) {
+    u32 sc = shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]);
+    Err_Row[i] = Err_Bit ? popcnt(sc ^ t[i].out) : alg_diff(t[i].out, sc);
+    scor += (u64)(Weight ? Weight[i] : 1) * Err_Row[i];
+  }
+  return scor >= 0xFFFFFFFFU ? 0xFFFFFFFFU : (u32)scor;
+}
+
+static score_kernel Kernel = kernel_alg_sat;
+static int          Kernel_Sat = 1; /* may Kernel exit early? */
+static const char  *Kernel_Name = "alg_sat";
+
+/*
+ * what score() runs: the table, or this generation's minibatch with
+ * its own kernel
+ */
+static const struct genx_test *Rows;
+static u32                     Rows_Len;
+
+int Batch = -1;
+static u32          Batch_Len = 0; /* rows in this table's minibatch */
+static int          Batch_On = 0;
+static struct genx_test *Mini = NULL;
+static u32         *Mini_Weight = NULL,
+                   *Perm = NULL,     /* the table's rows, shuffled */
+                    Perm_Len = 0,
+                    Perm_At = 0,     /* next window */
+                    Batch_Epoch = 0;
+static u64          Full_Wsum,       /* total weight, table and batch */
+                    Mini_Wsum;
+static const u32   *Full_Weight;
+static score_kernel Full_Kernel,
+                    Mini_Kernel;
+static int          Full_Sat,
+                    Mini_Sat;
+
+static int Split_On = 0;
+static u32 Elite_Cut = 0xFFFFFFFFU; /* split and mph scoring stop past this */
+
+/*
+ * SCORE_MPH: the rows are keys, a candidate's output picks a slot;
+ * the score is keys that land in a taken one. the slot is the output
+ * masked to a power of two size, else its remainder
+ */
+static u32 *Mph_Occ = NULL, /* slot bitmap */
+            Mph_Slots,
+            Mph_Words;
+
+static inline u32 mph_slot(u32 out)
+{
+  return Mph_Slots & (Mph_Slots - 1) ? out % Mph_Slots : out & (Mph_Slots - 1);
+}
+
+static u32 kernel_mph(const u8 *code, const struct genx_test *t, u32 n)
+{
+  u32 coll = 0,
+      i;
+  memset(Mph_Occ, 0, Mph_Words * sizeof *Mph_Occ);
+  for (i = 0; i < n; i++) {
+    const u32 s = mph_slot(shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]));
+    coll += Mph_Occ[s >> 5] >> (s & 31) & 1;
+    Mph_Occ[s >> 5] |= 1U << (s & 31);
+    if (coll > Elite_Cut)
+      return 0xFFFFFFFFU;
+  }
+  return coll;
+}
+
+static void mph_select(const genx_iface *iface)
+{
+  const u32 n = iface->test.i.data.len;
+  Mph_Slots = iface->v2.mph.slots ? iface->v2.mph.slots : n;
+  if (Mph_Slots < 1)
+    Mph_Slots = 1;
+  Mph_Words = (Mph_Slots + 31) / 32;
+  free(Mph_Occ);
+  Mph_Occ = malloc(Mph_Words * sizeof *Mph_Occ);
+  assert(Mph_Occ);
+}
+
+static u32 distance(const genx_iface *iface, u32 out, u32 sc)
+{
+  if (SCORE_BIT == iface->test.i.score)
+    return popcnt(sc ^ out); /* bitwise distance, for bitwise functions */
+  return alg_diff(out, sc); /* arithmetic distance */
+}
+
+enum run_const Const = CONST_ONCE;
+
+static u32 Const_Out,   /* the last constant scored, and its score */
+           Const_Score;
+static int Const_Valid = 0;
+
+/* score() on the minibatch (1) or the table (0) */
+static void rows_use(const genx_iface *iface, int mini)
+{
+  if (mini) {
+    Rows = Mini;
+    Rows_Len = Batch_Len;
+    Weight = Mini_Weight;
+    Kernel = Mini_Kernel;
+    Kernel_Sat = Mini_Sat;
+  } else {
+    Rows = iface->test.i.data.list;
+    Rows_Len = iface->test.i.data.len;
+    Weight = Full_Weight;
+    Kernel = Full_Kernel;
+    Kernel_Sat = Full_Sat;
+  }
+  Const_Valid = 0;
+}
+
+/* a minibatch score, in the table's units */
+static u32 batch_scale(u32 scor)
+{
+  double s;
+  if (Rows != Mini || 0 == Mini_Wsum)
+    return scor;
+  s = (double)scor * (double)Full_Wsum / (double)Mini_Wsum;
+  return s >= 0xFFFFFFFFU ? 0xFFFFFFFFU : (u32)s;
+}
+
+/* distance of rows t[0..n) from an output c they all get; w may be NULL */
+static u32 rows_const(const genx_iface *iface, const struct genx_test *t, u32 n,
+                      const u32 *w, u32 c)
+{
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < n; i++) {
+    scor += (u64)(w ? w[i] : 1) * distance(iface, t[i].out, c);
+    if (scor >= 0xFFFFFFFFU)
+      return 0xFFFFFFFFU;
+  }
+  return (u32)scor;
+}
+
+/**
+ * score an output that is the same for every test; no calls. the
+ * last one is remembered, most constant candidates return 0 or 1
+ */
+static u32 score_const(const genx_iface *iface, u32 c)
+{
+  const struct genx_test *t = Rows;
+  const u32 n = Rows_Len;
+  u32 scor,
+      i;
+  if (Const_Valid && c == Const_Out)
+    return Const_Score;
+  if (kernel_mph == Kernel) {
+    scor = n ? n - 1 : 0; /* one slot for all */
+  } else if (kernel_vec == Kernel) {
+    u64 d;
+    for (i = 0; i < n; i++)
+      Got[i] = c;
+    d = Dist_Fn(Got, Want, n);
+    scor = d > 0xFFFFFFFFU ? 0xFFFFFFFFU : (u32)d;
+  } else {
+    scor = rows_const(iface, t, n, Weight, c);
+  }
+  Const_Out = c;
+  Const_Score = scor;
+  Const_Valid = 1;
+  return scor;
+}
+
+int Cache = -1; /* -1: auto */
+static int Cache_On = 0;
+
+/* direct-mapped; key 0 is an empty slot */
+static struct cache {
+  u64 key;
+  u32 score,
+      screen,
+      err;   /* Cache_Err holds the slot's Err_Row */
+} Cache_Tab[RUN_CACHE_LEN];
+
+static u32 *Cache_Err = NULL; /* --lexicase: LEX_CASES per slot */
+
+static inline void cache_put(struct cache *c, u64 key, const genoscore *g)
+{
+  c->key = key;
+  c->score = g->score.i;
+  c->screen = g->screen;
+  c->err = NULL != Err_Row && NULL != Cache_Err;
+  if (c->err)
+    memcpy(Cache_Err + (size_t)(c - Cache_Tab) * LEX_CASES, Err_Row, Lex_Len * sizeof *Err_Row);
+}
+
+int Screen = 1;
+
+static struct genx_test Screen_Pick[RUN_SCREEN_LEN];
+static const struct genx_test *Screen_List;
+static u32          Screen_Len = 0,
+                    Screen_Cut = 0xFFFFFFFFU; /* pass if <= this */
+static score_kernel Screen_Kernel;
+
+/**
+ * the screen rows: the module's, an even spread over a big table, or none
+ */
+static void screen_select(const genx_iface *iface)
+{
+  const u32 n = iface->test.i.data.len;
+  u32 i;
+  Screen_Cut = 0xFFFFFFFFU;
+  Screen_Len = 0;
+  if (!Screen || SCORE_MPH == iface->test.i.score) /* a slot is taken or not by all of them */
+    return;
+  if (iface->v2.screen.len) {
+    Screen_List = iface->v2.screen.list;
+    Screen_Len = iface->v2.screen.len;
+  } else if (n >= RUN_SCREEN_MIN) {
+    for (i = 0; i < RUN_SCREEN_LEN; i++)
+      Screen_Pick[i] = iface->test.i.data.list[(u64)i * n / RUN_SCREEN_LEN];
+    Screen_List = Screen_Pick;
+    Screen_Len = RUN_SCREEN_LEN;
+  }
+  Screen_Kernel = SCORE_BIT == iface->test.i.score ? kernel_bit_sat : kernel_alg_sat;
+}
+
+/**
+ * called from pop_score() with the elites moved to the front: the
+ * next generation must screen within reach of the worst of them
+ */
+void screen_update(const struct pop *p, const genx_iface *iface)
+{
+  u32 worst = 0,
+      i;
+  if ((Split_On || kernel_mph == Full_Kernel) && !Batch_On) {
+    /* no cutoff under a minibatch: the rescored leaders mustn't exit */
+    for (i = 0; i < iface->opt.pop_keep; i++)
+      if (GENOSCORE_SCORE(p->indiv + i) > worst)
+        worst = GENOSCORE_SCORE(p->indiv + i);
+    Elite_Cut = worst + worst / RUN_SCREEN_SLACK;
+    if (Elite_Cut < worst)
+      Elite_Cut = 0xFFFFFFFFU;
+    worst = 0;
+  }
+  if (0 == Screen_Len)
+    return;
+  for (i = 0; i < iface->opt.pop_keep; i++)
+    if (p->indiv[i].screen > worst)
+      worst = p->indiv[i].screen;
+  Screen_Cut = worst + worst / RUN_SCREEN_SLACK;
+  if (Screen_Cut < worst)
+    Screen_Cut = 0xFFFFFFFFU;
+}
+
+/**
+ * minibatch or not, and what it runs; the shuffle starts over
+ */
+static void batch_select(const genx_iface *iface)
+{
+  const u32 n = iface->test.i.data.len;
+  const int len = -1 == Batch ? (n >= RUN_BATCH_MIN ? RUN_BATCH_LEN : 0) : Batch; /* Batch stays -1 */
+  u32 i;
+  Batch_On = len > 0 && (u32)len < n && SCORE_MPH != iface->test.i.score;
+  if (!Batch_On)
+    return;
+  Batch_Len = (u32)len;
+  Full_Wsum = n;
+  if (Weight)
+    for (i = 0, Full_Wsum = 0; i < n; i++)
+      Full_Wsum += Weight[i];
+  free(Mini);
+  free(Mini_Weight);
+  free(Perm);
+  Mini = malloc(Batch_Len * sizeof *Mini);
+  Mini_Weight = Weight ? malloc(Batch_Len * sizeof *Mini_Weight) : NULL;
+  Perm = malloc(n * sizeof *Perm);
+  assert(Mini && Perm && (Mini_Weight || !Weight));
+  for (i = 0; i < n; i++)
+    Perm[i] = i;
+  Perm_Len = n;
+  Perm_At = n; /* shuffle on the first draw */
+  if (Weight)
+    Mini_Kernel = SCORE_BIT == iface->test.i.score ? kernel_bit_wt : kernel_alg_wt;
+  else if (SCORE_BIT == iface->test.i.score)
+    Mini_Kernel = kernel_bit;
+  else
+    Mini_Kernel = kernel_alg_sat;
+  Mini_Sat = kernel_bit != Mini_Kernel;
+}
+
+/**
+ * called from pop_score() before anything is scored: the generation's
+ * minibatch is the next Batch_Len rows of the shuffle, reshuffled once
+ * every row has had its turn
+ */
+void batch_next(const genx_iface *iface)
+{
+  u32 i;
+  if (!Batch_On)
+    return;
+  if (Perm_At + Batch_Len > Perm_Len) {
+    for (i = Perm_Len - 1; i > 0; i--) {
+      u32 j = randr(0, i),
+          t = Perm[i];
+      Perm[i] = Perm[j];
+      Perm[j] = t;
+    }
+    Perm_At = 0;
+  }
+  Mini_Wsum = 0;
+  for (i = 0; i < Batch_Len; i++) {
+    const u32 r = Perm[Perm_At + i];
+    Mini[i] = iface->test.i.data.list[r];
+    if (Mini_Weight)
+      Mini_Wsum += Mini_Weight[i] = Full_Weight[r];
+  }
+  if (!Mini_Weight)
+    Mini_Wsum = Batch_Len;
+  Perm_At += Batch_Len;
+  Batch_Epoch++;
+  rows_use(iface, 1);
+}
+
+/**
+ * called from pop_score() with p->scores[0..scored) sorted by their
+ * minibatch scores: score the leaders on the whole table and re-sort
+ * them, so the elites come from exact scores
+ */
+void batch_rescore(struct pop *p, u32 scored, const genx_iface *iface)
+{
+  u32 top = iface->opt.pop_keep * RUN_BATCH_TOP,
+      i;
+  if (!Batch_On)
+    return;
+  rows_use(iface, 0);
+  if (top > scored)
+    top = scored;
+  for (i = 0; i < top; i++) {
+    genoscore *g = p->indiv + p->scores[i].id;
+    score(g, iface, 0);
+    p->scores[i].score = g->score;
+  }
+  qsort(p->scores, top, sizeof *p->scores, score_id_lencmp);
+}
+
+/**
+ * pick the kernel for this module's score type and test count
+ */
+void run_select(const genx_iface *iface)
+{
+  const u32 n = iface->test.i.data.len;
+  Const_Valid = 0;
+  Weight = iface->v2.weight;
+  Cache_On = 1 == Cache
+          || (-1 == Cache && (SCORE_HASH == iface->test.i.score
+                              ? 0 == iface->v2.hash.speed : n >= RUN_CACHE_MIN));
+  memset(Cache_Tab, 0, sizeof Cache_Tab);
+  canon_init(iface);
+  screen_select(iface);
+  lex_init(iface);
+  if (Cache_On && Lex_Len && NULL == Cache_Err) {
+    Cache_Err = malloc((size_t)RUN_CACHE_LEN * LEX_CASES * sizeof *Cache_Err);
+    assert(Cache_Err);
+  }
+  Err_Bit = SCORE_BIT == iface->test.i.score;
+  if (SCORE_MPH == iface->test.i.score) {
+    mph_select(iface);
+    Kernel = kernel_mph;
+    Kernel_Sat = 1;
+    Kernel_Name = "mph";
+  } else if (Weight) {
+    Kernel = SCORE_BIT == iface->test.i.score ? kernel_bit_wt : kernel_alg_wt;
+    Kernel_Sat = 1;
+    Kernel_Name = SCORE_BIT == iface->test.i.score ? "bit_wt" : "alg_wt";
+  } else if (1 == Vec || (-1 == Vec && n >= RUN_VEC_MIN)) {
+    u32 i;
+    if (n > Want_Len) {
+      free(Want);
+      free(Got);
+      Want = malloc(n * sizeof *Want);
+      Got = malloc(n * sizeof *Got);
+      assert(Want && Got);
+      Want_Len = n;
+    }
+    for (i = 0; i < n; i++)
+      Want[i] = iface->test.i.data.list[i].out;
+    if (NULL == Dist_Be)
+      Dist_Be = dist_best();
+    Dist_Fn = SCORE_BIT == iface->test.i.score ? Dist_Be->bit : Dist_Be->alg;
+    Kernel = kernel_vec;
+    Kernel_Sat = 0;
+    Kernel_Name = Dist_Be->name;
+  } else if (SCORE_BIT == iface->test.i.score && n < (1U << 27)) {
+    Kernel = kernel_bit;
+    Kernel_Sat = 0;
+    Kernel_Name = "bit";
+  } else {
+    Kernel = SCORE_BIT == iface->test.i.score ? kernel_bit_sat : kernel_alg_sat;
+    Kernel_Sat = 1;
+    Kernel_Name = SCORE_BIT == iface->test.i.score ? "bit_sat" : "alg_sat";
+  }
+  Full_Kernel = Kernel;
+  Full_Sat = Kernel_Sat;
+  Full_Weight = Weight;
+  Split_On = kernel_mph != Kernel && split_init(n);
+  Elite_Cut = 0xFFFFFFFFU;
+  batch_select(iface);
+  rows_use(iface, 0);
+}
+
+const char * run_kernel(void)
+{
+  return Kernel_Name;
+}
+
+void run_init(const genx_iface *iface)
 {
 #ifdef linux
   x86 = mmap(0, X86_BUFLEN, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
@@ -138,25 +696,51 @@ void run_init(void)
   assert(NULL != x86);
 #endif
   printf("x86=%p\n", (void *)x86);
+  run_select(iface);
+  printf("score kernel: %s\n", Kernel_Name);
+  printf("score cache: %s\n", Cache_On ? "on" : "off");
+  if (Batch_On)
+    printf("minibatch: %" PRIu32 " of %" PRIu32 " rows, top %" PRIu32 " rescored\n",
+      Batch_Len, iface->test.i.data.len, iface->opt.pop_keep * RUN_BATCH_TOP);
+  if (Screen_Len)
+    printf("screen: %" PRIu32 " rows (%s)\n", Screen_Len,
+      Screen_List == Screen_Pick ? "spread" : "module");
+  if (Lex_Len)
+    printf("lexicase%s: %" PRIu32 " cases, %d picks\n",
+      LEX_EPS == Lexicase ? " (eps)" : "", Lex_Len, LEX_PICKS);
 }
 
 /**
- * given a candidate function, test it against all input and return a
- * score -- a distance from the ideal output.
- * a score of 0 indicates a perfect match against the test input
+ * the slow path: score g like the kernels do, but printing as it
+ * goes; for verbose callers and -d/-D
  */
-void score(genoscore *g, const genx_iface *iface, int verbose)
+static void score_report(genoscore *g, const genx_iface *iface, u32 x86len, int table)
 {
-  volatile u32 scor = 0, i;
-  u32 targetsum = 0,
-      testcnt,
-      x86len = gen_compile(&g->geno, x86, X86_BUFLEN);
+  const struct genx_test *t = iface->test.i.data.list;
+  const u32 *w = Full_Weight;
+  u64 sum = 0;
+  u32 scor = 0,
+      targetsum = 0,
+      i;
   if (Dump > 0)
     x86_dump(x86, x86len, stdout);
   if (Dump > 1)
     (void)gen_dump(&g->geno, stdout);
-  //assert(score(x86, 1) == GENOSCORE_SCORE(g));
-  if (verbose || Dump >= 2) {
+  if (SCORE_MPH == iface->test.i.score) {
+    const u32 cut = Elite_Cut;
+    Elite_Cut = 0xFFFFFFFFU;
+    g->score.i = kernel_mph(x86, t, iface->test.i.data.len);
+    Elite_Cut = cut;
+    if (table) {
+      printf("mph: %" PRIu32 " of %" PRIu32 " keys collide in %" PRIu32 " slots; slot ",
+        g->score.i, iface->test.i.data.len, Mph_Slots);
+      for (i = 0; i < iface->test.i.data.len && i < 16; i++)
+        printf("%s%" PRIu32, i ? "," : "", mph_slot(shim_i(x86, t[i].in[0], t[i].in[1], t[i].in[2])));
+      printf("%s\n", i < iface->test.i.data.len ? ",..." : "");
+    }
+    return;
+  }
+  if (table)
     printf("%-35s %-23s %-23s\n"
            "----------------------------------- "
            "----------------------- "
@@ -166,51 +750,322 @@ void score(genoscore *g, const genx_iface *iface, int verbose)
            "----------- ----------- ----------- -----------\n",
            "Input", "Output", "Difference",
            "a", "b", "c", "expected", "actual", "diff", "sum(diff)");
-  }
-  testcnt = iface->test.i.data.len;
-  for (i = 0; i < testcnt; i++) {
-    volatile u32 sc   = shim_i(x86, iface->test.i.data.list[i].in[0],
-                                    iface->test.i.data.list[i].in[1],
-                                    iface->test.i.data.list[i].in[2]);
-    u32 diff;
-    targetsum += iface->test.i.data.list[i].out;
-    if (SCORE_BIT == iface->test.i.score) {
-      /*
-       * bitwise distance, useful for, well, bitwise functions
-       */
-      diff = popcnt(sc ^ iface->test.i.data.list[i].out);
-    } else {
-      /*
-       * arithmetic distance, useful for arithmetic functions
-       */
-      diff = (u32)abs((s32)iface->test.i.data.list[i].out - (s32)sc);
-    }
-    if (0xFFFFFFFFU - diff < scor) {
+  for (i = 0; i < iface->test.i.data.len; i++) {
+    u32 sc = shim_i(x86, t[i].in[0], t[i].in[1], t[i].in[2]),
+        diff = distance(iface, t[i].out, sc);
+    targetsum += t[i].out;
+    sum += (u64)(w ? w[i] : 1) * diff;
+    if (sum >= 0xFFFFFFFFU) {
       scor = 0xFFFFFFFFU;
       break;
     }
-    scor += diff;
-    if (verbose || Dump >= 2)
+    scor = (u32)sum;
+    if (table)
       printf(" 0x%08" PRIx32 "  0x%08" PRIx32 "  0x%08" PRIx32
-            "  0x%08" PRIx32 "  0x%08" PRIx32 " %11" PRIu32 " %11" PRIu32 "\n",
-        iface->test.i.data.list[i].in[0],
-        iface->test.i.data.list[i].in[1],
-        iface->test.i.data.list[i].in[2],
-        iface->test.i.data.list[i].out,
-        sc, diff, scor);
+             "  0x%08" PRIx32 "  0x%08" PRIx32 " %11" PRIu32 " %11" PRIu32 "\n",
+        t[i].in[0], t[i].in[1], t[i].in[2], t[i].out, sc, diff, scor);
   }
-  if (verbose || Dump >= 2) {
+  if (table)
     printf("score=%" PRIu32 "/%" PRIu32 " (%.7f%%)\n",
       scor, targetsum,
       100. - (((double)scor / (double)targetsum) * 100.));
-  }
   g->score.i = scor;
 }
 
+/**
+ * 1 in PROF_SAMPLE candidates: the same loop with every call timed,
+ * so prof.c can split exec from scoring arithmetic
+ */
+static u32 score_sampled(const genx_iface *iface, u64 *texec)
+{
+  const struct genx_test *t = Rows;
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < Rows_Len; i++) {
+    u64 te = prof_tsc();
+    u32 sc = shim_i(x86, t[i].in[0], t[i].in[1], t[i].in[2]);
+    *texec += prof_tsc() - te;
+    scor += (u64)(Weight ? Weight[i] : 1) * distance(iface, t[i].out, sc);
+    if (scor >= 0xFFFFFFFFU)
+      return 0xFFFFFFFFU;
+  }
+  return (u32)scor;
+}
+
+/* Err_Row from Lex_Rows, for a candidate that scored some other way */
+static void score_err(const genoscore *g)
+{
+  u32 i;
+  if (NULL == Err_Row || !GENOSCORE_NOT_WORST(g))
+    return;
+  for (i = 0; i < Lex_Len; i++) {
+    const struct genx_test *t = Lex_Rows + i;
+    u32 sc = shim_i(x86, t->in[0], t->in[1], t->in[2]);
+    Err_Row[i] = Err_Bit ? popcnt(sc ^ t->out) : alg_diff(t->out, sc);
+  }
+}
+
+/**
+ * given a candidate function, test it against all input and return a
+ * score -- a distance from the ideal output.
+ * a score of 0 indicates a perfect match against the test input
+ */
+void score(genoscore *g, const genx_iface *iface, int verbose)
+{
+  struct prof *prof = Prof;
+  const int samp = prof_sample(prof);
+  u64 t0 = prof_tsc(),
+      t1,
+      texec = 0;
+  u32 scor,
+      x86len = gen_compile(&g->geno, x86, X86_BUFLEN);
+  int split = 0;
+  u64 key = 0;
+  struct cache *slot = NULL;
+  t1 = prof_tsc();
+  prof->cyc[PROF_COMPILE] += t1 - t0;
+  if (verbose || Dump) {
+    if (SCORE_HASH != iface->test.i.score) {
+      score_report(g, iface, x86len, verbose || Dump >= 2);
+      return;
+    }
+    if (Dump > 0)
+      x86_dump(x86, x86len, stdout);
+    g->score.i = hash_score(x86, iface, 1);
+    return;
+  }
+  if (Cache_On) {
+    key = canon_hash(&g->geno);
+    if (Rows == Mini) /* a minibatch score is only good for its batch */
+      key ^= Batch_Epoch * 0x9E3779B97F4A7C15ULL;
+    key |= 1;
+    slot = Cache_Tab + (key & (RUN_CACHE_LEN - 1));
+    Mon[0].cache_lookup++;
+    if (slot->key == key) {
+      Mon[0].cache_hit++;
+      g->score.i = slot->score;
+      g->screen = slot->screen;
+      if (Err_Row && slot->err)
+        memcpy(Err_Row, Cache_Err + (size_t)(slot - Cache_Tab) * LEX_CASES, Lex_Len * sizeof *Err_Row);
+      else
+        score_err(g);
+      prof->cyc[PROF_SCORE] += prof_tsc() - t1;
+      return;
+    }
+  }
+  if (SCORE_HASH == iface->test.i.score) {
+    g->score.i = hash_score(x86, iface, 0);
+    g->screen = 0;
+    if (Cache_On)
+      cache_put(slot, key, g);
+    prof->loop += prof_tsc() - t1;
+    return;
+  }
+  if (Const && eff_const(&g->geno)) {
+    const struct genx_test *t = iface->test.i.data.list;
+    Mon[0].constant++;
+    if (CONST_REJECT == Const) {
+      g->score.i = 0xFFFFFFFFU;
+      g->screen = 0xFFFFFFFFU;
+    } else {
+      u32 c = shim_i(x86, t[0].in[0], t[0].in[1], t[0].in[2]);
+      g->score.i = batch_scale(score_const(iface, c));
+      if (Screen_Len)
+        g->screen = rows_const(iface, Screen_List, Screen_Len, NULL, c);
+    }
+    score_err(g);
+    if (Cache_On)
+      cache_put(slot, key, g);
+    prof->cyc[PROF_SCORE] += prof_tsc() - t1;
+    return;
+  }
+  if (Screen_Len) {
+    g->screen = Screen_Kernel(x86, Screen_List, Screen_Len);
+    if (g->screen > Screen_Cut) {
+      Mon[0].early_exit++;
+      g->score.i = 0xFFFFFFFFU;
+      prof->cyc[PROF_SCORE] += prof_tsc() - t1;
+      return;
+    }
+  }
+  if (Pmc)
+    pmc_exec_begin();
+  if (Err_Row && Lex_Rows == Rows)
+    scor = kernel_err(x86, Rows, Rows_Len);
+  else if ((split = Split_On && Rows != Mini))
+    scor = split_score(x86, x86len, Rows, Weight, Rows_Len,
+                       SCORE_BIT == iface->test.i.score, Elite_Cut);
+  else if (samp && kernel_mph != Kernel)
+    scor = score_sampled(iface, &texec);
+  else
+    scor = Kernel(x86, Rows, Rows_Len);
+  if (Pmc)
+    pmc_exec_end();
+  t0 = prof_tsc();
+  if (split) {
+    /* not sampled: one thread timing every row would stall the split */
+    prof->cyc[PROF_EXEC] += t0 - t1;
+  } else {
+    prof->loop += t0 - t1;
+    if (samp) {
+      prof->samp_loop += t0 - t1;
+      prof->samp_exec += texec;
+    }
+  }
+  if ((Kernel_Sat || Split_On) && 0xFFFFFFFFU == scor)
+    Mon[0].early_exit++;
+  g->score.i = batch_scale(scor);
+  if (Lex_Rows != Rows)
+    score_err(g);
+  /* the split cutoff moves like the screen's */
+  if (Cache_On && !((Split_On || kernel_mph == Kernel) && 0xFFFFFFFFU == scor))
+    cache_put(slot, key, g);
+}
+
+/**
+ * score(), leaving g's distance on each lexicase case in err[]
+ */
+void score_cases(genoscore *g, const genx_iface *iface, u32 *err)
+{
+  Err_Row = err;
+  score(g, iface, 0);
+  Err_Row = NULL;
+}
+
+int Speed = 0;
+
+static volatile u32 Speed_Mask = 0, /* opaque zero: chains calls via their output */
+                    Speed_Sink;
+static u64 Base_Lat = 0,
+           Base_Tput = 0;
+
+/* serializing rdtsc pair; nothing earlier leaks in, nothing later starts */
+static inline u64 tsc_begin(void)
+{
+  u32 lo, hi;
+  __asm__ volatile("lfence; rdtsc" : "=a"(lo), "=d"(hi) :: "memory");
+  return ((u64)hi << 32) | lo;
+}
+
+static inline u64 tsc_end(void)
+{
+  u32 lo, hi;
+  __asm__ volatile("rdtscp; lfence" : "=a"(lo), "=d"(hi) :: "ecx", "memory");
+  return ((u64)hi << 32) | lo;
+}
+
+/**
+ * time 'reps' passes over the tests with whatever is in x86[];
+ * latency feeds each output into the next input, throughput doesn't
+ */
+static u64 speed_batch(const genx_iface *iface, u32 reps, int latency)
+{
+  const u32 n = iface->test.i.data.len,
+            mask = Speed_Mask;
+  u32 x = 0,
+      r,
+      i;
+  u64 t0, t1;
+  t0 = tsc_begin();
+  if (latency) {
+    for (r = 0; r < reps; r++)
+      for (i = 0; i < n; i++)
+        x = shim_i(x86, iface->test.i.data.list[i].in[0] ^ (x & mask),
+                        iface->test.i.data.list[i].in[1],
+                        iface->test.i.data.list[i].in[2]);
+  } else {
+    for (r = 0; r < reps; r++)
+      for (i = 0; i < n; i++)
+        x += shim_i(x86, iface->test.i.data.list[i].in[0],
+                         iface->test.i.data.list[i].in[1],
+                         iface->test.i.data.list[i].in[2]);
+  }
+  t1 = tsc_end();
+  Speed_Sink = x;
+  return t1 - t0;
+}
+
+/**
+ * median of RUN_SPEED_BATCHES; one warm-up batch is thrown away and
+ * the median shrugs off interrupts and migrations
+ */
+static u64 speed_median(const genx_iface *iface, u32 reps, int latency)
+{
+  u64 t[RUN_SPEED_BATCHES];
+  u32 i, j;
+  (void)speed_batch(iface, 1, latency);
+  for (i = 0; i < RUN_SPEED_BATCHES; i++) {
+    u64 v = speed_batch(iface, reps, latency);
+    for (j = i; j > 0 && t[j - 1] > v; j--)
+      t[j] = t[j - 1];
+    t[j] = v;
+  }
+  return t[RUN_SPEED_BATCHES / 2];
+}
+
+/* cycles above the baseline per call, x16 */
+static u32 speed_per_call(u64 t, u64 base, u32 calls)
+{
+  return t > base ? (u32)(((t - base) * 16) / calls) : 0;
+}
+
+/**
+ * measure g's latency (the result, also stored in g->cyc) and
+ * throughput in cycles per call, x16
+ */
+u32 speed(genoscore *g, const genx_iface *iface, int verbose)
+{
+  const u32 n = iface->test.i.data.len,
+            reps = n >= RUN_SPEED_CALLS ? 1 : (RUN_SPEED_CALLS + n - 1) / n;
+  u64 lat, tput;
+  if (0 == Base_Lat) {
+    /* an empty function: the shim and call overhead we subtract */
+    struct op chromo[GEN_PREFIX_LEN + GEN_SUFFIX_LEN];
+    genotype empty = { 0, chromo, { 0, 0, { 0 } } };
+    empty.len = GEN_PREFIX_LEN;
+    GEN_PREFIX(&empty);
+    GEN_SUFFIX(&empty);
+    gen_compile(&empty, x86, X86_BUFLEN);
+    Base_Lat = speed_median(iface, reps, 1);
+    Base_Tput = speed_median(iface, reps, 0);
+  }
+  gen_compile(&g->geno, x86, X86_BUFLEN);
+  lat = speed_median(iface, reps, 1);
+  g->cyc = speed_per_call(lat, Base_Lat, reps * n);
+  if (verbose) {
+    tput = speed_median(iface, reps, 0);
+    printf("speed: latency %.2f throughput %.2f cycles/call"
+           " (above an empty function: %.2f %.2f)\n",
+      g->cyc / 16., speed_per_call(tput, Base_Tput, reps * n) / 16.,
+      (double)Base_Lat / (reps * n), (double)Base_Tput / (reps * n));
+  }
+  return g->cyc;
+}
+
+/**
+ * called from pop_score() with p->scores[0..scored) sorted; time the
+ * leading matches not yet measured and re-sort them. elites keep
+ * their measurement from the generation they were born in.
+ */
+void speed_rank(struct pop *p, u32 scored, const genx_iface *iface)
+{
+  u32 top = iface->opt.pop_keep * RUN_SPEED_TOP,
+      i;
+  if (top > scored)
+    top = scored;
+  for (i = 0; i < top && GENOSCORE_MATCH(p->scores + i); i++) {
+    genoscore *g = p->indiv + p->scores[i].id;
+    if (GENOSCORE_NOCYC == g->cyc)
+      speed(g, iface, 0);
+    p->scores[i].cyc = g->cyc;
+  }
+  qsort(p->scores, i, sizeof *p->scores, score_id_lencmp);
+}
+
 /**
  * execute f(in); ensure no collateral damage
  */
-static u32 shim_i(const void *f, u32 x, u32 y, u32 z)
+u32 shim_i(const void *f, u32 x, u32 y, u32 z)
 {
   volatile u32 out;
   __asm__ volatile(
@@ -251,7 +1106,7 @@ static u32 shim_i(const void *f, u32 x, u32 y, u32 z)
 
 #endif
 
-static u32 popcnt(u32 n)
+u32 popcnt(u32 n)
 {
   /*
    * store popcnts for all octet values
@@ -16,8 +16,110 @@
 #include "typ.h"
 #include "gen.h"
 
-void run_init(void);
+#define X86_BUFLEN 4096 /* bytes a compiled candidate may take */
+
+u8 * code_page(void);
+void code_page_free(u8 *);
+u32  cpu_count(u32 want); /* -j: 0 is one per online cpu */
+
+/*
+ * --speed: matching candidates are timed and ranked on measured
+ * latency before length. RUN_SPEED_BATCHES timed batches of at least
+ * RUN_SPEED_CALLS calls each; the median batch, less the median of an
+ * empty function, is the result.
+ */
+#define RUN_SPEED_BATCHES  15
+#define RUN_SPEED_CALLS    1024
+#define RUN_SPEED_TOP      4   /* measure the first pop_keep * this */
+#define RUN_SPEED_PATIENCE 500 /* generations without a faster match */
+#define RUN_SPEED_MARGIN   2   /* %, and at least a cycle, a speed-only gain must beat */
+
+extern int Speed;
+
+/*
+ * with at least this many tests, score by collecting every output and
+ * reducing the distance in one SIMD pass (dist.c); --vec/--no-vec
+ * force it either way
+ */
+#define RUN_VEC_MIN 256
+
+extern int Vec;
+
+/*
+ * candidates eff_const() proves can't depend on their input: score
+ * them from a single call, not at all (--reject-const) or like any
+ * other (--no-const)
+ */
+enum run_const {
+  CONST_OFF,
+  CONST_ONCE,
+  CONST_REJECT
+};
+
+extern enum run_const Const;
+
+/*
+ * cascade: candidates first run the module's screen rows, or
+ * RUN_SCREEN_LEN of their own spread over tables of RUN_SCREEN_MIN
+ * rows or more; only those within the elites' screen score (plus
+ * 1/RUN_SCREEN_SLACK of it) go on to the full table. --no-screen
+ */
+#define RUN_SCREEN_LEN   16
+#define RUN_SCREEN_MIN   128
+#define RUN_SCREEN_SLACK 4
+
+extern int Screen;
+
+/*
+ * scores by canon_hash(): a child that computes what an already
+ * scored genotype does isn't run again. hashing a long genotype costs
+ * about what running a few dozen tests does, so it's on from
+ * RUN_CACHE_MIN tests; --cache/--no-cache force it. early exits on
+ * the screen aren't kept, the cutoff moves. under --lexicase a slot
+ * keeps the candidate's case errors too.
+ */
+#define RUN_CACHE_BITS 16
+#define RUN_CACHE_LEN  (1 << RUN_CACHE_BITS)
+#define RUN_CACHE_MIN  64
+
+extern int Cache;
+
+/*
+ * minibatch: on tables of RUN_BATCH_MIN rows or more each generation
+ * scores on its own RUN_BATCH_LEN of them, the next window of a
+ * shuffle of the table, scaled up to the table's total weight; the
+ * first pop_keep * RUN_BATCH_TOP are then scored on the whole table
+ * again and re-sorted, so elites are picked by exact scores.
+ * --batch=rows, --no-batch
+ */
+#define RUN_BATCH_MIN 16384
+#define RUN_BATCH_LEN 1024
+#define RUN_BATCH_TOP 4
+
+extern int Batch; /* rows; -1 auto */
+
+void run_init(const genx_iface *);
+void run_select(const genx_iface *);
+const char * run_kernel(void);
 void score(genoscore *, const genx_iface *, int verbose);
+void score_cases(genoscore *, const genx_iface *, u32 *err);
+u32  speed(genoscore *, const genx_iface *, int verbose);
+void speed_rank(struct pop *, u32 scored, const genx_iface *);
+void screen_update(const struct pop *, const genx_iface *);
+void batch_next(const genx_iface *);
+void batch_rescore(struct pop *, u32 scored, const genx_iface *);
+u32  shim_i(const void *, u32, u32, u32) NOINLINE;
+u32  popcnt(u32 n);
+
+/**
+ * |(s32)want - (s32)sc|, wrapping like the hardware (and vpabsd) do
+ * instead of leaving INT_MIN to the compiler
+ */
+static inline u32 alg_diff(u32 want, u32 sc)
+{
+  u32 d = want - sc;
+  return (s32)d < 0 ? 0U - d : d;
+}
 
 #endif
 
@@ -0,0 +1,209 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * the workers start once and sleep between candidates. score() posts
+ * a job, works chunks itself from the caller's buffer, then waits for
+ * the rest. chunks come off a shared counter and their sums go into a
+ * shared total, under the lock: a u64 atomic would want cmpxchg8b
+ * under -m32, and it's once per SPLIT_CHUNK rows. whoever takes it
+ * past the cutoff raises stop, and the others see it before their
+ * next chunk.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "typ.h"
+#include "gen.h"
+#include "run.h"
+#include "mon.h"
+#include "split.h"
+
+int Split = -1;
+u32 Split_Threads = 0;
+
+static struct {
+  /* the job */
+  const u8               *code;
+  u32                     len;
+  const struct genx_test *t;
+  const u32              *w;
+  u32                     n,
+                          cut;
+  int                     bit;
+  volatile u32            next;  /* first chunk not yet handed out */
+  u64                     sum;   /* under lock */
+  volatile int            stop,
+                          quit;  /* split_fini(): workers unmap and leave */
+  /* the pool */
+  u32                     threads, /* workers, not counting the caller */
+                          seq,     /* jobs posted */
+                          busy;    /* workers still on this one */
+  pthread_mutex_t         lock;
+  pthread_cond_t          post,
+                          done;
+} S;
+
+struct split_worker {
+  u8              *code;
+  struct mon_stat *mon;
+};
+
+static u64 split_rows(const u8 *code, const struct genx_test *t, const u32 *w, u32 n)
+{
+  u64 scor = 0;
+  u32 i;
+  for (i = 0; i < n; i++) {
+    u32 sc = shim_i(code, t[i].in[0], t[i].in[1], t[i].in[2]),
+        d = S.bit ? popcnt(sc ^ t[i].out) : alg_diff(t[i].out, sc);
+    scor += w ? (u64)w[i] * d : d;
+  }
+  return scor;
+}
+
+/* take chunks until there are none or the total is past the cutoff */
+static void split_work(const u8 *code, struct mon_stat *mon)
+{
+  while (!S.stop) {
+    u32 at = __sync_fetch_and_add(&S.next, 1) * SPLIT_CHUNK,
+        n;
+    u64 part;
+    if (at >= S.n)
+      break;
+    n = S.n - at < SPLIT_CHUNK ? S.n - at : SPLIT_CHUNK;
+    part = split_rows(code, S.t + at, S.w ? S.w + at : NULL, n);
+    mon->rows += n;
+    pthread_mutex_lock(&S.lock);
+    S.sum += part;
+    if (S.sum > S.cut)
+      S.stop = 1;
+    pthread_mutex_unlock(&S.lock);
+  }
+}
+
+static void * split_thread(void *arg)
+{
+  struct split_worker *w = arg;
+  u32 seen = 0;
+  for (;;) {
+    pthread_mutex_lock(&S.lock);
+    while (seen == S.seq)
+      pthread_cond_wait(&S.post, &S.lock);
+    seen = S.seq;
+    pthread_mutex_unlock(&S.lock);
+    if (S.quit)
+      break;
+    /* the caller's buffer is rewritten for the next candidate */
+    memcpy(w->code, S.code, S.len);
+    split_work(w->code, w->mon);
+    pthread_mutex_lock(&S.lock);
+    if (0 == --S.busy)
+      pthread_cond_signal(&S.done);
+    pthread_mutex_unlock(&S.lock);
+  }
+  code_page_free(w->code);
+  free(w);
+  pthread_mutex_lock(&S.lock);
+  if (0 == --S.busy)
+    pthread_cond_signal(&S.done);
+  pthread_mutex_unlock(&S.lock);
+  return NULL;
+}
+
+/**
+ * start the workers, once, if the table is big enough
+ * @return whether score() should split
+ */
+int split_init(u32 rows)
+{
+  pthread_t th;
+  u32 threads = cpu_count(Split_Threads),
+      i;
+  if (0 == Split || (-1 == Split && rows < SPLIT_MIN))
+    return 0;
+  if (S.threads)
+    return 1;
+  if (threads < 2)
+    return 0;
+  pthread_mutex_init(&S.lock, NULL);
+  pthread_cond_init(&S.post, NULL);
+  pthread_cond_init(&S.done, NULL);
+  for (i = 1; i < threads; i++) {
+    struct split_worker *w = malloc(sizeof *w);
+    assert(w);
+    w->mon = mon_worker(S.threads);
+    if (NULL == (w->code = code_page())) {
+      free(w);
+      break;
+    }
+    if (pthread_create(&th, NULL, split_thread, w)) {
+      code_page_free(w->code);
+      free(w);
+      break;
+    }
+    pthread_detach(th);
+    S.threads++;
+  }
+  if (S.threads)
+    printf("split: %" PRIu32 " rows a chunk on %" PRIu32 " threads\n", (u32)SPLIT_CHUNK, S.threads + 1);
+  return S.threads > 0;
+}
+
+/**
+ * score code, len bytes, on t[0..n)
+ * @return the distance, 0xFFFFFFFF once past cut
+ */
+u32 split_score(const u8 *code, u32 len, const struct genx_test *t, const u32 *weight,
+                u32 n, int bit, u32 cut)
+{
+  assert(len <= X86_BUFLEN);
+  S.code = code;
+  S.len = len;
+  S.t = t;
+  S.w = weight;
+  S.n = n;
+  S.bit = bit;
+  S.cut = cut < 0xFFFFFFFEU ? cut : 0xFFFFFFFEU;
+  S.next = 0;
+  S.sum = 0;
+  S.stop = 0;
+  pthread_mutex_lock(&S.lock);
+  S.busy = S.threads;
+  S.seq++;
+  pthread_cond_broadcast(&S.post);
+  pthread_mutex_unlock(&S.lock);
+  split_work(code, Mon);
+  pthread_mutex_lock(&S.lock);
+  while (S.busy)
+    pthread_cond_wait(&S.done, &S.lock);
+  pthread_mutex_unlock(&S.lock);
+  return S.stop ? 0xFFFFFFFFU : (u32)S.sum;
+}
+
+
+/**
+ * stop the workers and release their code buffers
+ */
+void split_fini(void)
+{
+  if (0 == S.threads)
+    return;
+  pthread_mutex_lock(&S.lock);
+  S.quit = 1;
+  S.busy = S.threads;
+  S.seq++;
+  pthread_cond_broadcast(&S.post);
+  while (S.busy)
+    pthread_cond_wait(&S.done, &S.lock);
+  pthread_mutex_unlock(&S.lock);
+  S.threads = 0;
+  S.quit = 0;
+}
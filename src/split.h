@@ -0,0 +1,34 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * one candidate's test rows split across threads, for tables too big
+ * for a single core to get through a population in reasonable time.
+ * each thread runs its own copy of the code; all stop once the sum
+ * passes the cutoff.
+ */
+
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define SPLIT_MIN   65536 /* rows; below this the hand-off costs more  */
+#define SPLIT_CHUNK 4096  /* rows a thread takes at a time             */
+
+extern int Split;         /* --split/--no-split; -1: from SPLIT_MIN rows */
+extern u32 Split_Threads; /* -j; 0 is one per online cpu                */
+
+int split_init(u32 rows);
+u32 split_score(const u8 *code, u32 len, const struct genx_test *, const u32 *weight,
+                u32 n, int bit, u32 cut);
+void split_fini(void);
+
+#endif
+
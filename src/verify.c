@@ -0,0 +1,220 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * the inputs are numbered in[0] fastest, then in[1], in[2], each over
+ * its param's domain. threads take VERIFY_BLOCK of them at a time off
+ * a shared counter, collect the candidate's and func's outputs, and check the whole
+ * block with the bitwise distance from dist.c; only a block that
+ * differs is walked input by input. the sweep stops once
+ * VERIFY_CEX_MAX counterexamples are in hand.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "typ.h"
+#include "gen.h"
+#include "run.h"
+#include "dist.h"
+#include "mon.h"
+#include "verify.h"
+
+int Verify = 0;
+u32 Verify_Threads = 0;
+
+static struct {
+  const genx_iface  *iface;
+  const u8          *code;
+  dist_fn            bit;
+  u32                params, /* swept; the rest stay at lo */
+                     lo[3];
+  u64                size[3],
+                     total;
+  volatile u32       next;  /* first block not yet handed out */
+  volatile int       stop;
+  pthread_mutex_t    lock;
+  struct genx_test  *cex;
+  u32                ncex,
+                     max;
+} V;
+
+static void * verify_thread(void *arg)
+{
+  u32 got[VERIFY_BLOCK],
+      want[VERIFY_BLOCK],
+      col[3][VERIFY_BLOCK],
+      in[4] = { 0 },
+      n,
+      i,
+      k;
+  u64 pos[3],
+      x;
+  const u32 *const cols[3] = { col[0], col[1], col[2] };
+  struct mon_stat *mon = arg;
+  while (!V.stop) {
+    const u64 at = (u64)__sync_fetch_and_add(&V.next, 1) * VERIFY_BLOCK;
+    if (at >= V.total)
+      break;
+    n = V.total - at < VERIFY_BLOCK ? (u32)(V.total - at) : VERIFY_BLOCK;
+    mon->rows += n;
+    x = at;
+    for (k = 0; k < 3; k++) {
+      pos[k] = x % V.size[k];
+      x /= V.size[k];
+    }
+    for (i = 0; i < n; i++) {
+      for (k = 0; k < 3; k++)
+        col[k][i] = V.lo[k] + (u32)pos[k];
+      for (k = 0; k < 3 && ++pos[k] == V.size[k]; k++)
+        pos[k] = 0;
+      got[i] = shim_i(V.code, col[0][i], col[1][i], col[2][i]);
+    }
+    if (V.iface->v2.ref) {
+      V.iface->v2.ref(cols, want, n);
+    } else {
+      for (i = 0; i < n; i++) {
+        for (k = 0; k < 3; k++)
+          in[k] = col[k][i];
+        want[i] = V.iface->test.i.func(in);
+      }
+    }
+    if (0 == V.bit(got, want, n))
+      continue;
+    pthread_mutex_lock(&V.lock);
+    for (i = 0; i < n && V.ncex < V.max; i++) {
+      if (got[i] != want[i]) {
+        memset(V.cex + V.ncex, 0, sizeof *V.cex);
+        for (k = 0; k < 3; k++)
+          V.cex[V.ncex].in[k] = col[k][i];
+        V.cex[V.ncex].out = want[i];
+        V.ncex++;
+      }
+    }
+    if (V.ncex >= V.max)
+      V.stop = 1;
+    pthread_mutex_unlock(&V.lock);
+  }
+  return NULL;
+}
+
+/**
+ * sweep every combination of the params' domains; past VERIFY_MAX
+ * inputs the trailing params are held at their lo instead
+ * @return counterexamples written to cex[0..max), 0 if g is right everywhere
+ */
+u32 verify(const genoscore *g, const genx_iface *iface, struct genx_test *cex, u32 max)
+{
+  genotype tmp = { 0, NULL, { 0, 0, { 0 } } };
+  pthread_t *th;
+  u32 threads = cpu_count(Verify_Threads),
+      i;
+  u64 total = 1;
+  time_t t0 = time(NULL);
+  u8 *code;
+  if (NULL == iface->test.i.func && NULL == iface->v2.ref) {
+    printf("verify: module has no func, skipping\n");
+    return 0;
+  }
+  if (NULL == (code = code_page()))
+    return 0;
+  /* compile a copy: gen_compile() rewrites jump offsets in place */
+  tmp.chromo = malloc(CHROMO_SIZE(iface) * sizeof *tmp.chromo);
+  assert(tmp.chromo);
+  gen_copy(&tmp, &g->geno);
+  gen_compile(&tmp, code, X86_BUFLEN);
+  free(tmp.chromo);
+  V.iface = iface;
+  V.code = code;
+  V.bit = dist_best()->bit;
+  V.params = 0;
+  for (i = 0; i < 3; i++) {
+    const int given = i < iface->v2.domains;
+    V.lo[i] = given ? iface->v2.domain[i].lo : 0;
+    V.size[i] = (u64)(given ? iface->v2.domain[i].hi : 0xFFFFFFFFU) - V.lo[i] + 1;
+    if (i >= iface->opt.param_cnt && i > 0) {
+      V.size[i] = 1;
+    } else if (total <= VERIFY_MAX / V.size[i]) {
+      total *= V.size[i];
+      V.params = i + 1;
+    } else {
+      printf("verify: in[%" PRIu32 "] held at 0x%08" PRIx32 ", too many inputs to sweep\n", i, V.lo[i]);
+      V.size[i] = 1;
+    }
+  }
+  V.total = total;
+  V.next = 0;
+  V.stop = 0;
+  V.cex = cex;
+  V.ncex = 0;
+  V.max = max;
+  pthread_mutex_init(&V.lock, NULL);
+  printf("verify:");
+  for (i = 0; i < V.params; i++)
+    printf(" in[%" PRIu32 "]=0x%08" PRIx32 "..0x%08" PRIx32, i, V.lo[i], V.lo[i] + (u32)(V.size[i] - 1));
+  printf(" on %" PRIu32 " threads...", threads);
+  fflush(stdout);
+  th = malloc(threads * sizeof *th);
+  assert(th);
+  for (i = 0; i < threads; i++)
+    if (pthread_create(th + i, NULL, verify_thread, mon_worker(i))) {
+      perror("pthread_create");
+      threads = i;
+      break;
+    }
+  if (0 == threads)
+    verify_thread(Mon);
+  for (i = 0; i < threads; i++)
+    pthread_join(th[i], NULL);
+  free(th);
+  pthread_mutex_destroy(&V.lock);
+  code_page_free(code);
+  if (V.ncex)
+    printf("%" PRIu32 " counterexample%s, first f(0x%08" PRIx32 ")=0x%08" PRIx32 " (%lus)\n",
+      V.ncex, 1 == V.ncex ? "" : "s", cex[0].in[0], cex[0].out,
+      (unsigned long)(time(NULL) - t0));
+  else
+    printf("OK (%lus)\n", (unsigned long)(time(NULL) - t0));
+  return V.ncex;
+}
+
+static struct genx_test *Grown = NULL; /* the table once it has grown */
+static u32              *Grown_Weight = NULL;
+
+/**
+ * append cex[0..n) to the test table and re-pick the score kernel
+ */
+void verify_grow(genx_iface *iface, const struct genx_test *cex, u32 n)
+{
+  const u32 len = iface->test.i.data.len;
+  struct genx_test *t = realloc(Grown, (len + n) * sizeof *t);
+  assert(t);
+  if (NULL == Grown)
+    memcpy(t, iface->test.i.data.list, len * sizeof *t);
+  memcpy(t + len, cex, n * sizeof *t);
+  Grown = t;
+  iface->test.i.data.list = t;
+  if (iface->v2.weight) { /* a counterexample counts once */
+    u32 *w = realloc(Grown_Weight, (len + n) * sizeof *w),
+         i;
+    assert(w);
+    if (NULL == Grown_Weight)
+      memcpy(w, iface->v2.weight, len * sizeof *w);
+    for (i = len; i < len + n; i++)
+      w[i] = 1;
+    Grown_Weight = w;
+    iface->v2.weight = w;
+  }
+  iface->test.i.data.len = len + n;
+  printf("verify: test table %" PRIu32 " -> %" PRIu32 " rows\n", len, len + n);
+  run_select(iface);
+}
+
@@ -0,0 +1,33 @@
+/* ex: set ff=dos ts=2 et: */
+/* $Id$ */
+/*
+ * Copyright 2009 Ryan Flynn <URL: http://www.parseerror.com/>
+ *
+ * Released under the MIT License, see the "LICENSE.txt" file or
+ *   <URL: http://www.opensource.org/licenses/mit-license.php>
+ */
+/*
+ * --verify: a solution that matches the test table is run against
+ * test.i.func (v2.ref, a block at a time, if there is one) over the
+ * module's whole domain, every param's; inputs it gets wrong
+ * join the table and evolution resumes
+ */
+
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "typ.h"
+#include "gen.h"
+
+#define VERIFY_BLOCK   4096 /* inputs a thread takes at a time      */
+#define VERIFY_CEX_MAX 64   /* counterexamples kept per verification */
+#define VERIFY_MAX     ((u64)1 << 36) /* inputs swept, at most  */
+
+extern int Verify;
+extern u32 Verify_Threads; /* -j; 0 is one per online cpu */
+
+u32  verify(const genoscore *, const genx_iface *, struct genx_test *cex, u32 max);
+void verify_grow(genx_iface *, const struct genx_test *cex, u32 n);
+
+#endif
+
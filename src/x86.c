@@ -12,11 +12,21 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+# include <cpuid.h>
+# define X86_HAVE_CPUID
+#endif
 #include "typ.h"
 #include "rnd.h"
 #include "x86.h"
 
+u8  X86_Pick[X86_PICK_LEN];
+u32 X86_Weight[X86_COUNT];
+
+static u32 Iset = ~0U; /* bitmask of enum iset this cpu runs */
+
 void x86_dump(const u8 *x86, u32 len, FILE *f)
 {
   assert(len < 1024);
@@ -70,18 +80,24 @@ u8 gen_modrm(u8 digit)
   return modrm;
 }
 
+static const char reg[8][4] = {
+  "eax",
+  "ecx",
+  "edx",
+  "ebx",
+  "esp",
+  "ebp",
+  "esi",
+  "edi"
+};
+
+const char * x86_reg(u8 n)
+{
+  return reg[n & 7];
+}
+
 const const char * disp_modrm(u8 n, const u8 modrm, char *buf, size_t len)
 {
-  static const char reg[8][4] = {
-    "eax",
-    "ecx",
-    "edx",
-    "ebx",
-    "esp",
-    "ebp",
-    "esi",
-    "edi"
-  };
   if (R == modrm) {
     n -= 0xc0;
     snprintf(buf, len, "%%%s, %%%s", reg[n >> 3], reg[n & 7]);
@@ -102,18 +118,18 @@ const const char * disp_modrm(u8 n, const u8 modrm, char *buf, size_t len)
 const struct x86 X86[X86_COUNT] = {
   /* function op */
   /* descr                        opcode              oplen,modrmlen,modrm,imm */
-  { "enter"                   , { 0xc8, 0x00, 0, 0 }, 4, 0, R, 0, 0, I_186, 0,   0   },
-  { "push    %%ebp"           , { 0x55             }, 1, 0, R, 0, 0, I_86,  0,   0   },
-  { "mov     %%esp, %%ebp"    , { 0x89, 0xe5       }, 2, 0, R, 0, 0, I_86,  0,   0   },
-  { "mov     0x8(%%ebp), %%eax",{ 0x8b, 0x45, 0x08 }, 3, 0, R, 0, 0, I_86,  0,   0   },
-  { "mov     0xc(%%ebp), %%ebx",{ 0x8b, 0x5d, 0x0c }, 3, 0, R, 0, 0, I_86,  0,   0   },
-  { "mov     0x10(%%ebp), %%ecx",{0x8b, 0x4d, 0x10 }, 3, 0, R, 0, 0, I_86,  0,   0   },
-  { "sub     $0x14, %%esp"    , { 0x83, 0xec, 0x14 }, 3, 0, R, 0, 0, I_86,  0,   0   },
+  { "enter"                   , { 0xc8, 0x00, 0, 0 }, 4, 0, R, 0, 0, I_186, 0,   0, 0   },
+  { "push    %%ebp"           , { 0x55             }, 1, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "mov     %%esp, %%ebp"    , { 0x89, 0xe5       }, 2, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "mov     0x8(%%ebp), %%eax",{ 0x8b, 0x45, 0x08 }, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "mov     0xc(%%ebp), %%ebx",{ 0x8b, 0x5d, 0x0c }, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "mov     0x10(%%ebp), %%ecx",{0x8b, 0x4d, 0x10 }, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "sub     $0x14, %%esp"    , { 0x83, 0xec, 0x14 }, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
   /* function suffix */
-  { "add     $0x14, %%esp"    , { 0x83, 0xc4, 0x14 }, 3, 0, R, 0, 0, I_86,  FLT, 0   },
-  { "leave"                   , { 0xc9             }, 1, 0, R, 0, 0, I_186, 0,   0   },
-  { "pop     %%ebp"           , { 0x5d             }, 1, 0, R, 0, 0, I_86,  0,   0   },
-  { "ret"                     , { 0xc3             }, 1, 0, R, 0, 0, I_86,  0,   0   },
+  { "add     $0x14, %%esp"    , { 0x83, 0xc4, 0x14 }, 3, 0, R, 0, 0, I_86,  FLT, 0, 0   },
+  { "leave"                   , { 0xc9             }, 1, 0, R, 0, 0, I_186, 0,   0, 0   },
+  { "pop     %%ebp"           , { 0x5d             }, 1, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "ret"                     , { 0xc3             }, 1, 0, R, 0, 0, I_86,  0,   0, 0   },
 
   /* function contents */
 
@@ -122,169 +138,193 @@ const struct x86 X86[X86_COUNT] = {
    * NOTE: many opcodes have more than one associated mnuemonic, we
    *       strip all that shit out to increase signal/noise
    */
-  { "ja      0x%08" PRIx32    , { 0x0f, 0x87       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jae     0x%08" PRIx32    , { 0x0f, 0x83       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jb      0x%08" PRIx32    , { 0x0f, 0x82       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jbe     0x%08" PRIx32    , { 0x0f, 0x86       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "je      0x%08" PRIx32    , { 0x0f, 0x84       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jg      0x%08" PRIx32    , { 0x0f, 0x8f       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jge     0x%08" PRIx32    , { 0x0f, 0x8d       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jl      0x%08" PRIx32    , { 0x0f, 0x8c       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jle     0x%08" PRIx32    , { 0x0f, 0x8e       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jne     0x%08" PRIx32    , { 0x0f, 0x85       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jno     0x%08" PRIx32    , { 0x0f, 0x81       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jnp     0x%08" PRIx32    , { 0x0f, 0x8b       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jns     0x%08" PRIx32    , { 0x0f, 0x89       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jo      0x%08" PRIx32    , { 0x0f, 0x80       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "jp      0x%08" PRIx32    , { 0x0f, 0x8a       }, 2, 0, R, 4, 1, I_86,  0,   0   },
-  { "js      0x%08" PRIx32    , { 0x0f, 0x88       }, 2, 0, R, 4, 1, I_86,  0,   0   },
+  { "ja      0x%08" PRIx32    , { 0x0f, 0x87       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jae     0x%08" PRIx32    , { 0x0f, 0x83       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jb      0x%08" PRIx32    , { 0x0f, 0x82       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jbe     0x%08" PRIx32    , { 0x0f, 0x86       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "je      0x%08" PRIx32    , { 0x0f, 0x84       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jg      0x%08" PRIx32    , { 0x0f, 0x8f       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jge     0x%08" PRIx32    , { 0x0f, 0x8d       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jl      0x%08" PRIx32    , { 0x0f, 0x8c       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jle     0x%08" PRIx32    , { 0x0f, 0x8e       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jne     0x%08" PRIx32    , { 0x0f, 0x85       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jno     0x%08" PRIx32    , { 0x0f, 0x81       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jnp     0x%08" PRIx32    , { 0x0f, 0x8b       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jns     0x%08" PRIx32    , { 0x0f, 0x89       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jo      0x%08" PRIx32    , { 0x0f, 0x80       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "jp      0x%08" PRIx32    , { 0x0f, 0x8a       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
+  { "js      0x%08" PRIx32    , { 0x0f, 0x88       }, 2, 0, R, 4, 1, I_86,  0,   0, 0   },
 
   /*
    * integer-related ops
    */
 #ifdef X86_USE_INT
-  { "add     0x%02" PRIx8 "," , { 0x83             }, 1, 1, R, 1, 0, I_86,  INT, ALG },
-  { "add    "                 , { 0x01             }, 1, 1, R, 0, 0, I_86,  INT, ALG },
-  { "imul    0x%02" PRIx8 "," , { 0x6b             }, 1, 1, R, 1, 0, I_86,  INT, ALG },
-  { "imul   "                 , { 0x0f, 0xaf       }, 2, 1, R, 0, 0, I_86,  INT, ALG },
-  { "mov    "                 , { 0x8b             }, 1, 1, R, 0, 0, I_86,  INT, ALG },
-  { "xchg   "                 , { 0x87             }, 1, 1, R, 0, 0, I_86,  INT, 0   },
-  { "xor    "                 , { 0x33             }, 1, 1, R, 0, 0, I_86,  INT, BIT },
-  { "xor     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 6, 4, 0, I_86,  INT, BIT },
-  { "xadd   "                 , { 0x0f, 0xc1       }, 2, 1, R, 0, 0, I_486, INT, ALG },
-  { "shr     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 5, 1, 0, I_86,  INT, BIT },
-  { "shl     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 4, 1, 0, I_86,  INT, BIT },
-  { "or     "                 , { 0x0b             }, 1, 1, R, 0, 0, I_86,  INT, ALG },
-  { "and    "                 , { 0x23             }, 1, 1, R, 0, 0, I_86,  INT, ALG },
-  { "and     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 4, 4, 0, I_86,  INT, ALG },
-  { "neg    "                 , { 0xf7             }, 1, 1, 3, 0, 0, I_86,  INT, ALG },
-  { "not    "                 , { 0xf7             }, 1, 1, 2, 0, 0, I_86,  INT, ALG },
-  { "sub    "                 , { 0x29             }, 1, 1, R, 0, 0, I_86,  INT, ALG },
-  { "sub     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 5, 4, 0, I_86,  INT, ALG },
-  { "bt     "                 , { 0x0f, 0xa3       }, 2, 1, R, 0, 0, I_386, INT, ALG },
-  { "bt      0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 4, 1, 0, I_386, INT, ALG },
-  { "bsf    "                 , { 0x0f, 0xbc       }, 2, 1, R, 0, 0, I_386, INT, BIT },
-  { "bsr    "                 , { 0x0f, 0xbd       }, 2, 1, R, 0, 0, I_386, INT, BIT },
-  { "btc    "                 , { 0x0f, 0xbb       }, 2, 1, R, 0, 0, I_386, INT, BIT },
-  { "btc     0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 7, 1, 0, I_386, INT, BIT },
-  { "btr    "                 , { 0x0f, 0xb3       }, 2, 1, R, 0, 0, I_386, INT, BIT },
-  { "btr     0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 6, 1, 0, I_386, INT, ALG },
-  { "cmp    "                 , { 0x39             }, 1, 1, R, 0, 0, I_386, INT, ALG },
-  { "cmp     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 7, 4, 0, I_386, INT, ALG },
-  { "cmpxchg"                 , { 0x0f, 0xb1       }, 2, 1, R, 0, 0, I_486, INT, 0   },
-  { "rcl     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 2, 1, 0, I_86,  INT, BIT },
-  { "rcr     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 3, 1, 0, I_86,  INT, BIT },
-  { "rol     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, R, 1, 0, I_86,  INT, BIT },
-  { "ror     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 1, 1, 0, I_86,  INT, BIT },
-  { "cmova  "                 , { 0x0f, 0x47       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovb  "                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovbe "                 , { 0x0f, 0x46       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovc  "                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmove  "                 , { 0x0f, 0x44       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovg  "                 , { 0x0f, 0x4f       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovge "                 , { 0x0f, 0x4d       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovl  "                 , { 0x0f, 0x4c       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovle "                 , { 0x0f, 0x4e       }, 2, 1, R, 0, 0, I_686, INT, 0   },
+  { "add     0x%02" PRIx8 "," , { 0x83             }, 1, 1, R, 1, 0, I_86,  INT, ALG, 0 },
+  { "add    "                 , { 0x01             }, 1, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "imul    0x%02" PRIx8 "," , { 0x6b             }, 1, 1, R, 1, 0, I_86,  INT, ALG, 0 },
+  { "imul   "                 , { 0x0f, 0xaf       }, 2, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "mov    "                 , { 0x8b             }, 1, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "xchg   "                 , { 0x87             }, 1, 1, R, 0, 0, I_86,  INT, 0, 0   },
+  { "xor    "                 , { 0x33             }, 1, 1, R, 0, 0, I_86,  INT, BIT, 0 },
+  { "xor     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 6, 4, 0, I_86,  INT, BIT, 0 },
+  { "xadd   "                 , { 0x0f, 0xc1       }, 2, 1, R, 0, 0, I_486, INT, ALG, 0 },
+  { "shr     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 5, 1, 0, I_86,  INT, BIT, 0 },
+  { "shl     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 4, 1, 0, I_86,  INT, BIT, 0 },
+  { "or     "                 , { 0x0b             }, 1, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "and    "                 , { 0x23             }, 1, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "and     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 4, 4, 0, I_86,  INT, ALG, 0 },
+  { "neg    "                 , { 0xf7             }, 1, 1, 3, 0, 0, I_86,  INT, ALG, 0 },
+  { "not    "                 , { 0xf7             }, 1, 1, 2, 0, 0, I_86,  INT, ALG, 0 },
+  { "sub    "                 , { 0x29             }, 1, 1, R, 0, 0, I_86,  INT, ALG, 0 },
+  { "sub     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 5, 4, 0, I_86,  INT, ALG, 0 },
+  { "bt     "                 , { 0x0f, 0xa3       }, 2, 1, R, 0, 0, I_386, INT, ALG, 0 },
+  { "bt      0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 4, 1, 0, I_386, INT, ALG, 0 },
+  { "bsf    "                 , { 0x0f, 0xbc       }, 2, 1, R, 0, 0, I_386, INT, BIT, 0 },
+  { "bsr    "                 , { 0x0f, 0xbd       }, 2, 1, R, 0, 0, I_386, INT, BIT, 0 },
+  { "btc    "                 , { 0x0f, 0xbb       }, 2, 1, R, 0, 0, I_386, INT, BIT, 0 },
+  { "btc     0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 7, 1, 0, I_386, INT, BIT, 0 },
+  { "btr    "                 , { 0x0f, 0xb3       }, 2, 1, R, 0, 0, I_386, INT, BIT, 0 },
+  { "btr     0x%02" PRIx8 "," , { 0x0f, 0xba       }, 2, 1, 6, 1, 0, I_386, INT, ALG, 0 },
+  { "cmp    "                 , { 0x39             }, 1, 1, R, 0, 0, I_386, INT, ALG, 0 },
+  { "cmp     0x%08" PRIx32 ",", { 0x81             }, 1, 1, 7, 4, 0, I_386, INT, ALG, 0 },
+  { "cmpxchg"                 , { 0x0f, 0xb1       }, 2, 1, R, 0, 0, I_486, INT, 0, 0   },
+  { "rcl     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 2, 1, 0, I_86,  INT, BIT, 0 },
+  { "rcr     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 3, 1, 0, I_86,  INT, BIT, 0 },
+  { "rol     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, R, 1, 0, I_86,  INT, BIT, 0 },
+  { "ror     0x%02" PRIx8 "," , { 0xc1             }, 1, 1, 1, 1, 0, I_86,  INT, BIT, 0 },
+  { "cmova  "                 , { 0x0f, 0x47       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovb  "                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovbe "                 , { 0x0f, 0x46       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovc  "                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmove  "                 , { 0x0f, 0x44       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovg  "                 , { 0x0f, 0x4f       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovge "                 , { 0x0f, 0x4d       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovl  "                 , { 0x0f, 0x4c       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovle "                 , { 0x0f, 0x4e       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
 #if 0
-  { "cmovna "                 , { 0x0f, 0x46       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnae"                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnb "                 , { 0x0f, 0x43       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnbe"                 , { 0x0f, 0x47       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnc "                 , { 0x0f, 0x43       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovne "                 , { 0x0f, 0x45       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovng "                 , { 0x0f, 0x4e       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnge"                 , { 0x0f, 0x4c       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnl "                 , { 0x0f, 0x4d       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnle"                 , { 0x0f, 0x4f       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovno "                 , { 0x0f, 0x41       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnp "                 , { 0x0f, 0x4b       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovns "                 , { 0x0f, 0x49       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovnz "                 , { 0x0f, 0x45       }, 2, 1, R, 0, 0, I_686, INT, 0   },
+  { "cmovna "                 , { 0x0f, 0x46       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnae"                 , { 0x0f, 0x42       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnb "                 , { 0x0f, 0x43       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnbe"                 , { 0x0f, 0x47       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnc "                 , { 0x0f, 0x43       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovne "                 , { 0x0f, 0x45       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovng "                 , { 0x0f, 0x4e       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnge"                 , { 0x0f, 0x4c       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnl "                 , { 0x0f, 0x4d       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnle"                 , { 0x0f, 0x4f       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovno "                 , { 0x0f, 0x41       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnp "                 , { 0x0f, 0x4b       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovns "                 , { 0x0f, 0x49       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovnz "                 , { 0x0f, 0x45       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
 #endif
-  { "cmovo  "                 , { 0x0f, 0x40       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovp  "                 , { 0x0f, 0x4a       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovpe "                 , { 0x0f, 0x4a       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovpo "                 , { 0x0f, 0x4b       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovs  "                 , { 0x0f, 0x48       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "cmovz  "                 , { 0x0f, 0x44       }, 2, 1, R, 0, 0, I_686, INT, 0   },
-  { "inc    "                 , { 0xff             }, 1, 1, 0, 0, 0, I_86,  INT, 0   },
-  { "dec    "                 , { 0xff             }, 1, 1, 1, 0, 0, I_86,  INT, 0   },
+  { "cmovo  "                 , { 0x0f, 0x40       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovp  "                 , { 0x0f, 0x4a       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovpe "                 , { 0x0f, 0x4a       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovpo "                 , { 0x0f, 0x4b       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovs  "                 , { 0x0f, 0x48       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "cmovz  "                 , { 0x0f, 0x44       }, 2, 1, R, 0, 0, I_686, INT, 0, 0   },
+  { "inc    "                 , { 0xff             }, 1, 1, 0, 0, 0, I_86,  INT, 0, 0   },
+  { "dec    "                 , { 0xff             }, 1, 1, 1, 0, 0, I_86,  INT, 0, 0   },
+  { "popcnt "                 , { 0xf3, 0x0f, 0xb8 }, 3, 1, R, 0, 0, I_POPCNT, INT, BIT, 0 },
+  { "lzcnt  "                 , { 0xf3, 0x0f, 0xbd }, 3, 1, R, 0, 0, I_LZCNT,  INT, BIT, 0 },
+  { "tzcnt  "                 , { 0xf3, 0x0f, 0xbc }, 3, 1, R, 0, 0, I_BMI1,   INT, BIT, 0 },
+  { "adcx   "                 , { 0x66, 0x0f, 0x38, 0xf6 }, 4, 1, R, 0, 0, I_ADX, INT, ALG, 0 },
+  { "adox   "                 , { 0xf3, 0x0f, 0x38, 0xf6 }, 4, 1, R, 0, 0, I_ADX, INT, ALG, 0 },
+  /*
+   * BMI1/BMI2 use a 3-byte VEX prefix: c4 <RXB.mmmmm> <W.vvvv.L.pp> op;
+   * RXB are stored inverted and must be 1 in 32-bit mode or c4 decodes
+   * as les. op[2] holds vvvv=1111 (unused); for vex ops it is replaced
+   * by the register in data[0].
+   * @ref: #1 S 2.3 Intel AVX and VEX encoding
+   */
+  { "andn   "                 , { 0xc4, 0xe2, 0x78, 0xf2 }, 4, 1, R, 0, 0, I_BMI1, INT, BIT, 1 },
+  { "blsr   "                 , { 0xc4, 0xe2, 0x78, 0xf3 }, 4, 1, 1, 0, 0, I_BMI1, INT, BIT, 1 },
+  { "blsmsk "                 , { 0xc4, 0xe2, 0x78, 0xf3 }, 4, 1, 2, 0, 0, I_BMI1, INT, BIT, 1 },
+  { "blsi   "                 , { 0xc4, 0xe2, 0x78, 0xf3 }, 4, 1, 3, 0, 0, I_BMI1, INT, BIT, 1 },
+  { "bextr  "                 , { 0xc4, 0xe2, 0x78, 0xf7 }, 4, 1, R, 0, 0, I_BMI1, INT, BIT, 1 },
+  { "bzhi   "                 , { 0xc4, 0xe2, 0x78, 0xf5 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "pdep   "                 , { 0xc4, 0xe2, 0x7b, 0xf5 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "pext   "                 , { 0xc4, 0xe2, 0x7a, 0xf5 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "shlx   "                 , { 0xc4, 0xe2, 0x79, 0xf7 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "shrx   "                 , { 0xc4, 0xe2, 0x7b, 0xf7 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "sarx   "                 , { 0xc4, 0xe2, 0x7a, 0xf7 }, 4, 1, R, 0, 0, I_BMI2, INT, BIT, 1 },
+  { "rorx    0x%02" PRIx8 "," , { 0xc4, 0xe3, 0x7b, 0xf0 }, 4, 1, R, 1, 0, I_BMI2, INT, BIT, 0 },
 #endif
 
-  { "lea     0x8(%%ebp), %%eax" ,{ 0x8d, 0x45, 0x08}, 3, 0, R, 0, 0, I_86,  0,   0   },
+  { "lea     0x8(%%ebp), %%eax" ,{ 0x8d, 0x45, 0x08}, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
 
-  { "seta   "                   ,{ 0x0f, 0x97      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setae  "                   ,{ 0x0f, 0x93      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setb   "                   ,{ 0x0f, 0x92      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setbe  "                   ,{ 0x0f, 0x96      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "sete   "                   ,{ 0x0f, 0x94      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setg   "                   ,{ 0x0f, 0x9f      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setge  "                   ,{ 0x0f, 0x9d      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setl   "                   ,{ 0x0f, 0x9c      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setle  "                   ,{ 0x0f, 0x9e      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setne  "                   ,{ 0x0f, 0x95      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setns  "                   ,{ 0x0f, 0x99      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "seto   "                   ,{ 0x0f, 0x90      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setp   "                   ,{ 0x0f, 0x9a      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "setpo  "                   ,{ 0x0f, 0x9b      }, 2, 1, R, 0, 0, I_386, 0,   0   },
-  { "sets   "                   ,{ 0x0f, 0x98      }, 2, 1, R, 0, 0, I_386, 0,   0   },
+  { "seta   "                   ,{ 0x0f, 0x97      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setae  "                   ,{ 0x0f, 0x93      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setb   "                   ,{ 0x0f, 0x92      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setbe  "                   ,{ 0x0f, 0x96      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "sete   "                   ,{ 0x0f, 0x94      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setg   "                   ,{ 0x0f, 0x9f      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setge  "                   ,{ 0x0f, 0x9d      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setl   "                   ,{ 0x0f, 0x9c      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setle  "                   ,{ 0x0f, 0x9e      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setne  "                   ,{ 0x0f, 0x95      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setns  "                   ,{ 0x0f, 0x99      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "seto   "                   ,{ 0x0f, 0x90      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setp   "                   ,{ 0x0f, 0x9a      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "setpo  "                   ,{ 0x0f, 0x9b      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
+  { "sets   "                   ,{ 0x0f, 0x98      }, 2, 1, R, 0, 0, I_386, 0,   0, 0   },
 
 /*
  * x86 floating point operations
  */
 
 #ifdef X86_USE_FLOAT
-  { "mov     %%eax, -0x14(%%ebp)",{0x8b, 0x45, 0xce}, 3, 0, R, 0, 0, I_86,  0,   0   },
-  { "fld     0x8(%%ebp)"      , { 0xd9, 0x45, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0   },
+  { "mov     %%eax, -0x14(%%ebp)",{0x8b, 0x45, 0xce}, 3, 0, R, 0, 0, I_86,  0,   0, 0   },
+  { "fld     0x8(%%ebp)"      , { 0xd9, 0x45, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0, 0   },
   { "mov     $0x%08" PRIx32 ", -0x14(%%ebp)",
-                                { 0xc7, 0x45, 0xec }, 3, 0, R, 4, 0, I_86,  FLT, 0   },
-  { "fld     -0x14(%%ebp)"    , { 0xd9, 0x45, 0xec }, 3, 0, R, 0, 0, I_87,  FLT, 0   },
-  { "fild    0x8(%%ebp)"      , { 0xdb, 0x45, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0   },
+                                { 0xc7, 0x45, 0xec }, 3, 0, R, 4, 0, I_86,  FLT, 0, 0   },
+  { "fld     -0x14(%%ebp)"    , { 0xd9, 0x45, 0xec }, 3, 0, R, 0, 0, I_87,  FLT, 0, 0   },
+  { "fild    0x8(%%ebp)"      , { 0xdb, 0x45, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0, 0   },
 #if 0
   /*
    * doesn't work on my Pentium 3 at home
    * TODO: add ability to generate opcodes by target machine
    */
-  { "fisttp  0x8(%%ebp)"      , { 0xdb, 0x4d, 0x08 }, 3, 0, R, 0, 0, I_SSE, FLT, ALG },
+  { "fisttp  0x8(%%ebp)"      , { 0xdb, 0x4d, 0x08 }, 3, 0, R, 0, 0, I_SSE, FLT, ALG, 0 },
 #endif
-  { "fist    0x8(%%ebp)"      , { 0xdb, 0x55, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0   },
-  { "fistp   0x8(%%ebp)"      , { 0xdb, 0x5d, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0   },
+  { "fist    0x8(%%ebp)"      , { 0xdb, 0x55, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0, 0   },
+  { "fistp   0x8(%%ebp)"      , { 0xdb, 0x5d, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, 0, 0   },
 #if 0
   /* this instruction is expensive in terms of cycles */
-  { "f2xm1"                   , { 0xd9, 0xf0       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
+  { "f2xm1"                   , { 0xd9, 0xf0       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
 #endif
-  { "fprem"                   , { 0xd9, 0xf8       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fsqrt"                   , { 0xd9, 0xfa       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fsincos"                 , { 0xd9, 0xfb       }, 2, 0, R, 0, 0, I_387, FLT, ALG },
-  { "fscale"                  , { 0xd9, 0xfd       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fsin"                    , { 0xd9, 0xfe       }, 2, 0, R, 0, 0, I_387, FLT, ALG },
-  { "fcos"                    , { 0xd9, 0xff       }, 2, 0, R, 0, 0, I_387, FLT, ALG },
-  { "fchs"                    , { 0xd9, 0xe0       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fxam"                    , { 0xd9, 0xe5       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fld1"                    , { 0xd9, 0xe8       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fldl2t"                  , { 0xd9, 0xe9       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fldl2e"                  , { 0xd9, 0xea       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fldpi"                   , { 0xd9, 0xeb       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fldlg2"                  , { 0xd9, 0xec       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fldln2"                  , { 0xd9, 0xed       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fabs"                    , { 0xd9, 0xe1       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fmulp"                   , { 0xde, 0xc9       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "faddp"                   , { 0xde, 0xc1       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "frndint"                 , { 0xd9, 0xfc       }, 2, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fcomi   %%st,%%st(1)"    , { 0xdb, 0xf1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcomip  %%st,%%st(1)"    , { 0xdf, 0xf1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fucomi  %%st,%%st(1)"    , { 0xdb, 0xe9       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fucomip %%st,%%st(1)"    , { 0xdf, 0xe9       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "ficom   %%st(0),0x8(%%ebp)",{0xda, 0x55, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "ficomp  %%st(0),0x8(%%ebp)",{0xda, 0x5d, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, ALG },
-  { "fcmovb  %%st(0),%%st(1)" , { 0xda, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmove  %%st(0),%%st(1)" , { 0xda, 0xc9       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovbe %%st(0),%%st(1)" , { 0xda, 0xd1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovu  %%st(0),%%st(1)" , { 0xda, 0xd9       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovnb %%st(0),%%st(1)" , { 0xdb, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovne %%st(0),%%st(1)" , { 0xdb, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovnbe %%st(0),%%st(1)", { 0xdb, 0xd1       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
-  { "fcmovnu %%st(0),%%st(1)" , { 0xdb, 0xd9       }, 2, 0, R, 0, 0, I_686, FLT, ALG },
+  { "fprem"                   , { 0xd9, 0xf8       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fsqrt"                   , { 0xd9, 0xfa       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fsincos"                 , { 0xd9, 0xfb       }, 2, 0, R, 0, 0, I_387, FLT, ALG, 0 },
+  { "fscale"                  , { 0xd9, 0xfd       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fsin"                    , { 0xd9, 0xfe       }, 2, 0, R, 0, 0, I_387, FLT, ALG, 0 },
+  { "fcos"                    , { 0xd9, 0xff       }, 2, 0, R, 0, 0, I_387, FLT, ALG, 0 },
+  { "fchs"                    , { 0xd9, 0xe0       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fxam"                    , { 0xd9, 0xe5       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fld1"                    , { 0xd9, 0xe8       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fldl2t"                  , { 0xd9, 0xe9       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fldl2e"                  , { 0xd9, 0xea       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fldpi"                   , { 0xd9, 0xeb       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fldlg2"                  , { 0xd9, 0xec       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fldln2"                  , { 0xd9, 0xed       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fabs"                    , { 0xd9, 0xe1       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fmulp"                   , { 0xde, 0xc9       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "faddp"                   , { 0xde, 0xc1       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "frndint"                 , { 0xd9, 0xfc       }, 2, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fcomi   %%st,%%st(1)"    , { 0xdb, 0xf1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcomip  %%st,%%st(1)"    , { 0xdf, 0xf1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fucomi  %%st,%%st(1)"    , { 0xdb, 0xe9       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fucomip %%st,%%st(1)"    , { 0xdf, 0xe9       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "ficom   %%st(0),0x8(%%ebp)",{0xda, 0x55, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "ficomp  %%st(0),0x8(%%ebp)",{0xda, 0x5d, 0x08 }, 3, 0, R, 0, 0, I_87,  FLT, ALG, 0 },
+  { "fcmovb  %%st(0),%%st(1)" , { 0xda, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmove  %%st(0),%%st(1)" , { 0xda, 0xc9       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovbe %%st(0),%%st(1)" , { 0xda, 0xd1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovu  %%st(0),%%st(1)" , { 0xda, 0xd9       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovnb %%st(0),%%st(1)" , { 0xdb, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovne %%st(0),%%st(1)" , { 0xdb, 0xc1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovnbe %%st(0),%%st(1)", { 0xdb, 0xd1       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
+  { "fcmovnu %%st(0),%%st(1)" , { 0xdb, 0xd9       }, 2, 0, R, 0, 0, I_686, FLT, ALG, 0 },
 #endif
 
 };
@@ -306,8 +346,127 @@ u8 x86_by_name(const char *descr)
   return off;
 }
 
-void x86_init(void)
+/**
+ * which instruction sets can this cpu run?
+ * @ref: #1 S 3-180 CPUID, Table 3-20
+ */
+static void x86_cpuid(void)
+{
+#ifdef X86_HAVE_CPUID
+  unsigned a, b, c, d;
+  /* anything with cpuid is at least a late 486 */
+  Iset = (1 << I_86) | (1 << I_186) | (1 << I_286)
+       | (1 << I_386) | (1 << I_486);
+  if (!__get_cpuid(1, &a, &b, &c, &d))
+    return;
+  if (d & (1 << 0))  /* FPU */
+    Iset |= (1 << I_87) | (1 << I_287) | (1 << I_387);
+  if (d & (1 << 8))  /* CX8 */
+    Iset |= 1 << I_586;
+  if ((d & (1 << 15)) && (Iset & (1 << I_586))) /* CMOV */
+    Iset |= 1 << I_686;
+  if (d & (1 << 23))
+    Iset |= 1 << I_MMX;
+  if (d & (1 << 25))
+    Iset |= 1 << I_SSE;
+  if (c & (1 << 23))
+    Iset |= 1 << I_POPCNT;
+  if (__get_cpuid_max(0, NULL) >= 7) {
+    __cpuid_count(7, 0, a, b, c, d);
+    if (b & (1 << 3))
+      Iset |= 1 << I_BMI1;
+    if (b & (1 << 8))
+      Iset |= 1 << I_BMI2;
+    if (b & (1 << 19))
+      Iset |= 1 << I_ADX;
+  }
+  if (__get_cpuid(0x80000001, &a, &b, &c, &d) && (c & (1 << 5))) /* ABM */
+    Iset |= 1 << I_LZCNT;
+#endif
+}
+
+int x86_iset_ok(enum iset set)
+{
+  return !!(Iset & (1 << set));
+}
+
+/**
+ * does X86[i] belong in this run at all, per the module's options?
+ */
+static int x86_allowed(const struct x86 *x, u32 i, const struct x86_opts *o)
+{
+  if (i < X86_FIRST || !x86_iset_ok(x->set))
+    return 0;
+  if ((INT == x->flt && !o->int_ops) || (FLT == x->flt && !o->float_ops))
+    return 0;
+  if ((ALG == x->alg && !o->algebra_ops) || (BIT == x->alg && !o->bit_ops))
+    return 0;
+  if (x->immlen && !x->jcc && !o->random_const)
+    return 0;
+#ifdef X86_USE_FLOAT
+  if (FLD_14EBP == i && !o->random_const)
+    return 0;
+#endif
+  return 1;
+}
+
+/**
+ * "cmova" names every "cmova ..." but not "cmovae ..."
+ */
+static int x86_mnemonic_eq(const char *name, const char *descr)
+{
+  size_t len = strlen(name);
+  return 0 == strncmp(name, descr, len) && (' ' == descr[len] || '\0' == descr[len]);
+}
+
+/**
+ * every enabled op gets one slot so nothing becomes unreachable,
+ * the rest are handed out in proportion to weight
+ */
+void x86_pick_build(void)
+{
+  u64 total = 0,
+      cum = 0;
+  u32 i,
+      n = 0,
+      k = 0;
+  for (i = 0; i < X86_COUNT; i++) {
+    total += X86_Weight[i];
+    if (X86_Weight[i])
+      X86_Pick[k++] = (u8)i, n++;
+  }
+  if (0 == n) {
+    fprintf(stderr, "no x86 ops enabled, check module options\n");
+    exit(EXIT_FAILURE);
+  }
+  assert(n <= X86_PICK_LEN);
+  for (i = 0; k < X86_PICK_LEN; k++) {
+    u64 at = ((u64)(2 * (k - n) + 1) * total) / (2 * (X86_PICK_LEN - n));
+    while (cum + X86_Weight[i] <= at)
+      cum += X86_Weight[i++];
+    X86_Pick[k] = (u8)i;
+  }
+}
+
+void x86_pick_report(FILE *f)
+{
+  u32 slots[X86_COUNT] = { 0 },
+      i;
+  for (i = 0; i < X86_PICK_LEN; i++)
+    slots[X86_Pick[i]]++;
+  for (i = X86_FIRST; i < X86_COUNT; i++)
+    if (X86_Weight[i])
+      fprintf(f, "  %5" PRIu32 " %4" PRIu32 "/%u %2" PRIu32 " %.*s\n",
+        X86_Weight[i], slots[i], X86_PICK_LEN, i,
+        (int)strcspn(X86[i].descr, " "), X86[i].descr);
+}
+
+void x86_init(const struct genx_iface *iface)
 {
+  const struct x86_weight *w;
+  u32 i,
+      n = 0,
+      nocpu = 0;
   /* double-check instruction enum and table */
   printf("X86_COUNT=%u (sizeof X86 / sizeof X86[0])=%lu\n",
     X86_COUNT, (unsigned long)(sizeof X86 / sizeof X86[0]));
@@ -319,5 +478,26 @@ void x86_init(void)
   assert(0 == strncmp("cmovne",  X86[CMOVNE]     .descr, 6));
   assert(0 == strncmp("cmovz",   X86[CMOVZ]      .descr, 5));
 #endif
+  x86_cpuid();
+  for (i = 0; i < X86_COUNT; i++) {
+    X86_Weight[i] = x86_allowed(X86 + i, i, &iface->opt.x86) ? X86_WEIGHT_DEFAULT : 0;
+    nocpu += i >= X86_FIRST && !x86_iset_ok(X86[i].set);
+  }
+  for (w = iface->v2.op_weight; w && w->name; w++) {
+    int found = 0;
+    for (i = X86_FIRST; i < X86_COUNT; i++) {
+      if (x86_mnemonic_eq(w->name, X86[i].descr)) {
+        found = 1;
+        if (X86_Weight[i])
+          X86_Weight[i] = w->weight;
+      }
+    }
+    if (!found)
+      fprintf(stderr, "weight: no x86 op named \"%s\"\n", w->name);
+  }
+  for (i = 0; i < X86_COUNT; i++)
+    n += !!X86_Weight[i];
+  printf("x86: %" PRIu32 " of %u ops enabled (%" PRIu32 " unsupported by cpu)\n",
+    n, X86_COUNT - X86_FIRST, nocpu);
+  x86_pick_build();
 }
-
@@ -19,11 +19,13 @@
 
 #include <stddef.h>
 #include "typ.h"
+#include "rnd.h"
 #include "gen.h"
 
-void         x86_init(void);
+void         x86_init(const struct genx_iface *);
 u8           gen_modrm(u8 digit);
 const char * disp_modrm(u8 n, const u8 modrm, char *buf, size_t len);
+const char * x86_reg(u8 n);
 void         x86_dump(const u8 *x86, u32 len, FILE *f);
 
 # define X86_NOTFOUND 0xFF
@@ -50,6 +52,11 @@ enum iset {
   I_686,
   I_MMX,
   I_SSE,
+  I_POPCNT,
+  I_LZCNT,
+  I_BMI1,
+  I_BMI2,
+  I_ADX,
   I_COUNT /* last, special */
 };
 
@@ -95,6 +102,8 @@ struct x86 {
   enum iset set;
   enum iflt flt;
   enum ialg alg;
+  u8        vex;      /* VEX.vvvv names a random register,
+                       * kept in op.data[0], patched into op[2] */
 };
 
 enum {
@@ -212,6 +221,23 @@ enum {
   CMOVZ,
   INC,
   DEC,
+  POPCNT_R32,
+  LZCNT_R32,
+  TZCNT_R32,
+  ADCX_R32,
+  ADOX_R32,
+  ANDN,
+  BLSR,
+  BLSMSK,
+  BLSI,
+  BEXTR,
+  BZHI,
+  PDEP,
+  PEXT,
+  SHLX,
+  SHRX,
+  SARX,
+  RORX,
 #endif
 
   LEA_8EBP_EAX,
@@ -285,7 +311,6 @@ enum {
 
 #if 0
   /* instructions i have tried to add but have failed for one reason or another */
-  POPCNT,
   BSWAP_EDX,
   IDIV_R32,
 #endif
@@ -293,5 +318,26 @@ enum {
   X86_COUNT /* last, special */
 };
 
+/*
+ * mutation draws opcodes from a flat table built once per run from
+ * the module's options, its weights and what this cpu supports; one
+ * rnd32() and a load per pick, no rejection
+ */
+#define X86_PICK_BITS 12
+#define X86_PICK_LEN  (1 << X86_PICK_BITS)
+#define X86_WEIGHT_DEFAULT 100
+
+extern u8  X86_Pick[X86_PICK_LEN];
+extern u32 X86_Weight[X86_COUNT]; /* effective weight per op, 0 = never */
+
+int  x86_iset_ok(enum iset);
+void x86_pick_build(void);
+void x86_pick_report(FILE *);
+
+static inline u8 x86_random(void)
+{
+  return X86_Pick[rnd32() >> (32 - X86_PICK_BITS)];
+}
+
 #endif
 